@@ -0,0 +1,58 @@
+/*
+ * bench.h
+ *
+ * Helpers shared by the benchmark applications in bench/. Each benchmark is a
+ * complete application that replaces main.c: build it with
+ *
+ *     ./configure.py --board <board> --app bench/<name>.c
+ *
+ * Results are printed on the debug serial port, one "name: value" per line.
+ * Benchmarks finish with sys_reset(), which re-runs them on a board and exits
+ * the process on the host port.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "drivers/driver_serial.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Prints "label: value\r\n" on the debug serial port, without pulling
+ * in printf. negative prefixes the value with a minus sign.
+ */
+static inline void bench_print(const char* label, uint32_t value,
+                               bool negative)
+{
+    char digits[12];
+    int i = sizeof(digits);
+
+    digits[--i] = '\0';
+    do
+    {
+        digits[--i] = '0' + (value % 10);
+        value /= 10;
+    } while(value);
+    if(negative)
+        digits[--i] = '-';
+
+    Serial_puts(Serial_module_debug, label);
+    Serial_puts(Serial_module_debug, ": ");
+    Serial_puts(Serial_module_debug, &digits[i]);
+    Serial_puts(Serial_module_debug, "\r\n");
+}
+
+static inline void bench_report(const char* label, uint32_t value)
+{
+    bench_print(label, value, false);
+}
+
+static inline void bench_report_signed(const char* label, int32_t value)
+{
+    bench_print(label, value < 0 ? -(uint32_t) value : (uint32_t) value,
+                value < 0);
+}
+
+#endif /* BENCH_H_ */
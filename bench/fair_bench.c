@@ -0,0 +1,135 @@
+/*
+ * fair_bench.c
+ *
+ * Proportional-share benchmark, for KERNEL_FAIR_SHARE:
+ *
+ *     ./configure.py --board <board> --app bench/fair_bench.c \
+ *         --define KERNEL_FAIR_SHARE=1
+ *
+ * BENCH_THREADS CPU-bound threads are spawned with the weights in
+ * bench_weights[] while thread 0 sleeps for BENCH_MS. The weights are then
+ * reversed with sys_set_weight() and the run repeated. For each run and
+ * thread it reports the expected and achieved share of the CPU time the
+ * threads used between them, in tenths of a percent, measured with
+ * sys_thread_stats(), and whether every share came within BENCH_TOLERANCE
+ * tenths of a percent of its target.
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "drivers/driver_serial.h"
+#include "kernel.h"
+#include "syscalls.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if !KERNEL_FAIR_SHARE
+#error "fair_bench.c needs --define KERNEL_FAIR_SHARE=1"
+#endif
+
+#define BENCH_THREADS (3)
+
+#ifndef BENCH_MS
+#define BENCH_MS (3000)
+#endif
+
+#ifndef BENCH_TOLERANCE
+#define BENCH_TOLERANCE (20)
+#endif
+
+static const uint32_t bench_weights[BENCH_THREADS] = {10, 30, 60};
+
+static tid_t tids[BENCH_THREADS];
+
+int spinner_main(void* arg)
+{
+    (void) arg;
+
+    while(1)
+        ;
+}
+
+/*
+ * CPU time used so far by each spinner, in cycles.
+ */
+static void sample(uint64_t* cycles)
+{
+    tstat_t stats[MAX_THREADS];
+    uint32_t i, j, n;
+
+    n = sys_thread_stats(stats, MAX_THREADS);
+    for(i = 0; i < BENCH_THREADS; i++)
+        for(j = 0; j < n; j++)
+            if(stats[j].id == tids[i])
+                cycles[i] = stats[j].cycles;
+}
+
+static bool run(const char* name, const uint32_t* weights)
+{
+    uint64_t before[BENCH_THREADS], after[BENCH_THREADS], total = 0;
+    uint32_t i, weight_sum = 0, expected, achieved, error;
+    bool pass = true;
+
+    for(i = 0; i < BENCH_THREADS; i++)
+        weight_sum += weights[i];
+
+    sample(before);
+    sys_sleep(BENCH_MS);
+    sample(after);
+
+    for(i = 0; i < BENCH_THREADS; i++)
+        total += after[i] - before[i];
+
+    Serial_puts(Serial_module_debug, name);
+    Serial_puts(Serial_module_debug, "\r\n");
+    for(i = 0; i < BENCH_THREADS; i++)
+    {
+        expected = weights[i] * 1000 / weight_sum;
+        achieved = (uint32_t)((after[i] - before[i]) * 1000 / total);
+        error = achieved > expected ? achieved - expected
+                                    : expected - achieved;
+        if(error > BENCH_TOLERANCE)
+            pass = false;
+
+        bench_report(" weight", weights[i]);
+        bench_report("  expected_permille", expected);
+        bench_report("  achieved_permille", achieved);
+    }
+    bench_report(" within_tolerance", pass);
+
+    return pass;
+}
+
+int main(void)
+{
+    thread_attr_t attr = {0};
+    uint32_t reversed[BENCH_THREADS];
+    uint32_t i;
+
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    for(i = 0; i < BENCH_THREADS; i++)
+    {
+        attr.weight = bench_weights[i];
+        tids[i] = sys_spawn_attr(spinner_main, NULL, &attr);
+    }
+
+    bench_report("threads", BENCH_THREADS);
+    bench_report("ms", BENCH_MS);
+
+    run("spawned", bench_weights);
+
+    for(i = 0; i < BENCH_THREADS; i++)
+    {
+        reversed[i] = bench_weights[BENCH_THREADS - 1 - i];
+        sys_set_weight(tids[i], reversed[i]);
+    }
+    run("reweighted", reversed);
+
+    sys_reset();
+}
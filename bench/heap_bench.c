@@ -0,0 +1,204 @@
+/*
+ * heap_bench.c
+ *
+ * Allocator latency benchmark. Thread 0 runs the same random workload of
+ * BENCH_OPS operations three times: BENCH_SLOTS slots, each either empty or
+ * holding a block of 1 to BENCH_MAX_SIZE bytes; every operation picks a
+ * slot and frees its block or fills it. The three runs use
+ *
+ *     tlsf    heap_kernel() called directly: the allocator itself
+ *     heap    heap_alloc() and heap_free(), through the kernel
+ *     malloc  malloc() and free()
+ *
+ * On the host malloc() is the C library's; on the boards it is routed to
+ * the heap (see HEAP_MALLOC), so the last run measures the same path as the
+ * second. For each run it reports the average and worst-case latency of
+ * allocating and of freeing, in nanoseconds, measured with port_cycles().
+ * Finally it reports the heap's peak usage and fragmentation.
+ *
+ * Before any of that it reports heap_ok, whether a first allocation from
+ * the heap succeeded; if it is 0, the heap could not be set up and the
+ * figures that follow only time failures. With THREAD_REENT it also spawns
+ * a thread and reports reent_own, whether that thread got newlib state of
+ * its own from the heap rather than falling back to thread 0's, and
+ * reent_bytes, what that state costs per thread.
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "drivers/driver_serial.h"
+#include "heap.h"
+#include "kernel.h"
+#include "port.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if THREAD_REENT
+#include <reent.h>
+#endif
+
+#ifndef BENCH_OPS
+#define BENCH_OPS (100000)
+#endif
+
+#ifndef BENCH_SLOTS
+#define BENCH_SLOTS (32)
+#endif
+
+#ifndef BENCH_MAX_SIZE
+#define BENCH_MAX_SIZE (128)
+#endif
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+
+typedef struct
+{
+    const char* name;
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr);
+} allocator_t;
+
+// Latency statistics for one kind of operation, in cycles
+typedef struct
+{
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+} stats_t;
+
+static void* tlsf_alloc(size_t size)
+{
+    return heap_kernel(HEAP_OP_ALLOC, NULL, size);
+}
+
+static void tlsf_free(void* ptr)
+{
+    heap_kernel(HEAP_OP_FREE, ptr, 0);
+}
+
+static const allocator_t allocators[] = {
+    {"tlsf", tlsf_alloc, tlsf_free},
+    {"heap", heap_alloc, heap_free},
+    {"malloc", malloc, free},
+};
+
+static void* slots[BENCH_SLOTS];
+
+#if THREAD_REENT
+static volatile bool reent_own, reent_checked;
+
+int reent_main(void* arg)
+{
+    (void) arg;
+
+    reent_own = thread_current->reent != _global_impure_ptr;
+    reent_checked = true;
+    return 0;
+}
+#endif
+
+static void stats_add(stats_t* s, uint32_t cycles)
+{
+    s->count++;
+    s->total += cycles;
+    if(cycles > s->max)
+        s->max = cycles;
+}
+
+static void stats_report(const char* name, const stats_t* s)
+{
+    Serial_puts(Serial_module_debug, name);
+    Serial_puts(Serial_module_debug, "\r\n");
+    bench_report("  count", s->count);
+    bench_report("  avg_ns", s->count ? (uint32_t)(s->total * 1000 /
+                                                   CYCLES_PER_US / s->count)
+                                      : 0);
+    bench_report("  max_ns", (uint32_t)((uint64_t) s->max * 1000 /
+                                        CYCLES_PER_US));
+}
+
+static void run(const allocator_t* a)
+{
+    stats_t allocs = {0}, frees = {0};
+    uint32_t seed = 12345, i, slot, start, end, failures = 0;
+    size_t size;
+
+    for(i = 0; i < BENCH_OPS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        slot = (seed >> 16) % BENCH_SLOTS;
+        size = 1 + (seed >> 8) % BENCH_MAX_SIZE;
+
+        if(slots[slot])
+        {
+            start = port_cycles();
+            a->free(slots[slot]);
+            end = port_cycles();
+            stats_add(&frees, end - start);
+            slots[slot] = NULL;
+        }
+        else
+        {
+            start = port_cycles();
+            slots[slot] = a->alloc(size);
+            end = port_cycles();
+            stats_add(&allocs, end - start);
+            if(!slots[slot])
+                failures++;
+        }
+    }
+
+    for(slot = 0; slot < BENCH_SLOTS; slot++)
+    {
+        a->free(slots[slot]);
+        slots[slot] = NULL;
+    }
+
+    Serial_puts(Serial_module_debug, a->name);
+    Serial_puts(Serial_module_debug, "\r\n");
+    stats_report(" alloc", &allocs);
+    stats_report(" free", &frees);
+    bench_report(" failures", failures);
+}
+
+int main(void)
+{
+    heap_stats_t stats;
+    uint32_t i;
+    void* p;
+
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    bench_report("ops", BENCH_OPS);
+    bench_report("slots", BENCH_SLOTS);
+    bench_report("max_size", BENCH_MAX_SIZE);
+
+    p = heap_alloc(1);
+    bench_report("heap_ok", p != NULL);
+    heap_free(p);
+
+#if THREAD_REENT
+    sys_spawn(reent_main, NULL);
+    while(!reent_checked)
+        sys_yield();
+    bench_report("reent_own", reent_own);
+    bench_report("reent_bytes", sizeof(struct _reent));
+#endif
+
+    for(i = 0; i < sizeof(allocators) / sizeof(allocators[0]); i++)
+        run(&allocators[i]);
+
+    heap_stats(&stats);
+    bench_report("heap_size", stats.size);
+    bench_report("heap_peak", stats.peak);
+    bench_report("heap_fragmentation_pct", stats.fragmentation);
+
+    sys_reset();
+}
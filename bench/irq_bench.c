@@ -0,0 +1,123 @@
+/*
+ * irq_bench.c
+ *
+ * Interrupt latency benchmark. The board's latency probe (see
+ * board_probe_start()) interrupts every BENCH_PERIOD_US and records how long
+ * after the timer expired its handler started, while two threads keep the
+ * kernel busy: one makes long system calls (sys_thread_stats() over the
+ * whole thread table) back to back, and the other spends its time in
+ * critical_enter() sections of BENCH_CRITICAL_US.
+ *
+ * Thread 0 runs the probe for BENCH_MS twice: first at the kernel's
+ * priority, where it has to wait for the kernel and the critical sections,
+ * then as a zero-latency interrupt above PORT_KERNEL_PRIORITY, which
+ * preempts both. For each it reports the number of interrupts and the
+ * average and worst-case latency, in nanoseconds.
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "critical.h"
+#include "drivers/driver_serial.h"
+#include "kernel.h"
+#include "port.h"
+#include "syscalls.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef BENCH_MS
+#define BENCH_MS (2000)
+#endif
+
+#ifndef BENCH_PERIOD_US
+#define BENCH_PERIOD_US (250)
+#endif
+
+#ifndef BENCH_CRITICAL_US
+#define BENCH_CRITICAL_US (50)
+#endif
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+
+// Probe statistics, in cycles; only the probe's handler writes them
+static volatile uint32_t count;
+static volatile uint32_t max_late;
+static volatile uint64_t total_late;
+
+static tstat_t stats[MAX_THREADS];
+
+static void probe_fn(uint32_t late)
+{
+    count++;
+    total_late += late;
+    if(late > max_late)
+        max_late = late;
+}
+
+int syscall_main(void* arg)
+{
+    (void) arg;
+
+    while(1)
+        sys_thread_stats(stats, MAX_THREADS);
+}
+
+int critical_main(void* arg)
+{
+    irqstate_t state;
+    uint32_t start;
+
+    (void) arg;
+
+    while(1)
+    {
+        state = critical_enter();
+        start = port_cycles();
+        while(port_cycles() - start < BENCH_CRITICAL_US * CYCLES_PER_US)
+            ;
+        critical_exit(state);
+    }
+}
+
+static void run(const char* name, bool zero_latency)
+{
+    count = 0;
+    max_late = 0;
+    total_late = 0;
+
+    board_probe_start(BENCH_PERIOD_US * CYCLES_PER_US, zero_latency,
+                      probe_fn);
+    sys_sleep(BENCH_MS);
+    board_probe_stop();
+
+    Serial_puts(Serial_module_debug, name);
+    Serial_puts(Serial_module_debug, "\r\n");
+    bench_report(" count", count);
+    bench_report(" avg_ns", count ? (uint32_t)(total_late * 1000 /
+                                               CYCLES_PER_US / count)
+                                  : 0);
+    bench_report(" max_ns", (uint32_t)((uint64_t) max_late * 1000 /
+                                       CYCLES_PER_US));
+}
+
+int main(void)
+{
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    sys_spawn(syscall_main, NULL);
+    sys_spawn(critical_main, NULL);
+
+    bench_report("period_us", BENCH_PERIOD_US);
+    bench_report("critical_us", BENCH_CRITICAL_US);
+
+    run("kernel_priority", false);
+    run("zero_latency", true);
+
+    sys_reset();
+}
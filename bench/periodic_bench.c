@@ -0,0 +1,146 @@
+/*
+ * periodic_bench.c
+ *
+ * Periodic release jitter and drift benchmark. Thread 0 runs BENCH_PERIODS
+ * periods of BENCH_PERIOD_MS twice: first with the classic relative loop
+ * (sys_sleep(period) after some work), then with periodic_wait(), which
+ * sleeps until absolute release times. Each period does BENCH_WORK_US of
+ * busy work, and a background thread keeps the CPU loaded.
+ *
+ * For each loop it reports the shortest and longest interval between
+ * consecutive releases and the drift: how far the last release is from
+ * where BENCH_PERIODS exact periods after the first would put it. All in
+ * microseconds, measured with port_cycles().
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "drivers/driver_serial.h"
+#include "kernel.h"
+#include "periodic.h"
+#include "port.h"
+#include "syscalls.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef BENCH_PERIODS
+#define BENCH_PERIODS (10000)
+#endif
+
+#ifndef BENCH_PERIOD_MS
+#define BENCH_PERIOD_MS (2)
+#endif
+
+#ifndef BENCH_WORK_US
+#define BENCH_WORK_US (1200)
+#endif
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+
+int load_main(void* arg)
+{
+    (void) arg;
+
+    while(1)
+        sys_yield();
+}
+
+static void work(void)
+{
+    uint32_t start = port_cycles();
+
+    while(port_cycles() - start < BENCH_WORK_US * CYCLES_PER_US)
+        ;
+}
+
+/*
+ * Interval statistics for one loop. Intervals are measured between
+ * consecutive releases and summed in 64 bits, since port_cycles() wraps.
+ */
+typedef struct
+{
+    uint32_t last;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} stats_t;
+
+static void stats_start(stats_t* s)
+{
+    s->last = port_cycles();
+    s->min = UINT32_MAX;
+    s->max = 0;
+    s->total = 0;
+}
+
+static void stats_release(stats_t* s)
+{
+    uint32_t now = port_cycles();
+    uint32_t interval = now - s->last;
+
+    s->last = now;
+    s->total += interval;
+    if(interval < s->min)
+        s->min = interval;
+    if(interval > s->max)
+        s->max = interval;
+}
+
+static void stats_report(const char* name, const stats_t* s)
+{
+    int64_t ideal = (int64_t) BENCH_PERIODS * BENCH_PERIOD_MS * 1000 *
+                    CYCLES_PER_US;
+
+    Serial_puts(Serial_module_debug, name);
+    Serial_puts(Serial_module_debug, "\r\n");
+    bench_report("interval_min_us", s->min / CYCLES_PER_US);
+    bench_report("interval_max_us", s->max / CYCLES_PER_US);
+    bench_report_signed("drift_us",
+                        (int32_t)(((int64_t) s->total - ideal) /
+                                  CYCLES_PER_US));
+}
+
+int main(void)
+{
+    stats_t stats;
+    periodic_t p;
+    uint32_t i;
+
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    sys_spawn(load_main, NULL);
+
+    bench_report("periods", BENCH_PERIODS);
+    bench_report("period_ms", BENCH_PERIOD_MS);
+
+    // Relative: the release time slips by the work and the wakeup latency
+    sys_sleep(1);
+    stats_start(&stats);
+    for(i = 0; i < BENCH_PERIODS; i++)
+    {
+        work();
+        sys_sleep(BENCH_PERIOD_MS);
+        stats_release(&stats);
+    }
+    stats_report("sleep", &stats);
+
+    // Absolute: releases stay on the BENCH_PERIOD_MS grid
+    periodic_init(&p, BENCH_PERIOD_MS);
+    periodic_wait(&p);
+    stats_start(&stats);
+    for(i = 0; i < BENCH_PERIODS; i++)
+    {
+        work();
+        periodic_wait(&p);
+        stats_release(&stats);
+    }
+    stats_report("sleep_until", &stats);
+    bench_report("overruns", p.overruns);
+
+    sys_reset();
+}
@@ -0,0 +1,72 @@
+/*
+ * sched_bench.c
+ *
+ * Scheduler throughput benchmark. BENCH_THREADS threads do nothing but
+ * sys_yield() and count how often they get to run; thread 0 sleeps for
+ * BENCH_MS and then reports the number of context switches per second.
+ *
+ * The result includes the cost of the scheduling policy's decisions, so the
+ * benchmark is meant to be run against each policy in turn (see sched.h):
+ *
+ *     ./configure.py --board host --app bench/sched_bench.c \
+ *         --define KERNEL_SCHED_POLICY=SCHED_POLICY_RR
+ *
+ * and likewise with SCHED_POLICY_PRIO and SCHED_POLICY_EDF. The policy built
+ * in is reported as its number.
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "drivers/driver_serial.h"
+#include "kernel.h"
+#include "syscalls.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef BENCH_THREADS
+#define BENCH_THREADS (MAX_THREADS - 1)
+#endif
+
+#ifndef BENCH_MS
+#define BENCH_MS (2000)
+#endif
+
+volatile uint32_t yield_counts[BENCH_THREADS];
+
+int yielder_main(void* arg)
+{
+    volatile uint32_t* count = (volatile uint32_t*) arg;
+
+    while(1)
+    {
+        (*count)++;
+        sys_yield();
+    }
+}
+
+int main(void)
+{
+    uint32_t i, total = 0;
+
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    for(i = 0; i < BENCH_THREADS; i++)
+        sys_spawn(yielder_main, (void*) &yield_counts[i]);
+
+    sys_sleep(BENCH_MS);
+
+    for(i = 0; i < BENCH_THREADS; i++)
+        total += yield_counts[i];
+
+    bench_report("policy", KERNEL_SCHED_POLICY);
+    bench_report("threads", BENCH_THREADS);
+    bench_report("switches", total);
+    bench_report("switches_per_sec", (uint32_t)(((uint64_t)total * 1000) / BENCH_MS));
+
+    sys_reset();
+}
@@ -0,0 +1,147 @@
+/*
+ * serial_bench.c
+ *
+ * UART transmit benchmark (TM4C123). Sends BENCH_BYTES on BENCH_MODULE at
+ * BENCH_BAUD three ways:
+ *
+ *     polled - UARTCharPut() per byte, the driver's original transmit path
+ *     ring   - Serial_writebuf() in chunks below SERIAL_DMA_MIN, through the
+ *              interrupt-driven TX ring
+ *     dma    - a single Serial_writebuf(), sent by the uDMA
+ *
+ * and reports the throughput and the share of the CPU each path uses. A
+ * spinner thread counts loop iterations whenever it runs; CPU use is how much
+ * of its unloaded rate (measured first, with thread 0 asleep) it loses while
+ * a transfer is in progress. Results are printed on the debug port.
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "drivers/driver_serial.h"
+#include "driverlib/uart.h"
+#include "inc/hw_memmap.h"
+#include "kernel.h"
+#include "port.h"
+#include "syscalls.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef BENCH_MODULE
+#define BENCH_MODULE (Serial_module_1)
+#endif
+
+#ifndef BENCH_BASE
+#define BENCH_BASE (UART1_BASE)
+#endif
+
+#ifndef BENCH_BAUD
+#define BENCH_BAUD (1000000)
+#endif
+
+#ifndef BENCH_BYTES
+#define BENCH_BYTES (16384)
+#endif
+
+#ifndef BENCH_CAL_MS
+#define BENCH_CAL_MS (500)
+#endif
+
+static uint8_t payload[BENCH_BYTES];
+
+volatile uint32_t spins;
+
+int spinner_main(void* arg)
+{
+    (void) arg;
+
+    while(1)
+        spins++;
+}
+
+static void send_polled(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < BENCH_BYTES; i++)
+        UARTCharPut(BENCH_BASE, payload[i]);
+}
+
+static void send_ring(void)
+{
+    uint32_t i, n;
+
+    for(i = 0; i < BENCH_BYTES; i += n)
+    {
+        n = BENCH_BYTES - i;
+        if(SERIAL_DMA_MIN && n >= SERIAL_DMA_MIN)
+            n = SERIAL_DMA_MIN - 1;
+        Serial_writebuf(BENCH_MODULE, &payload[i], n);
+    }
+}
+
+static void send_dma(void)
+{
+    Serial_writebuf(BENCH_MODULE, payload, BENCH_BYTES);
+}
+
+/*
+ * Runs one transfer to completion and reports bytes per second and the CPU
+ * share, in percent, that it took away from the spinner.
+ */
+static void run(const char* name, void (*send)(void), uint32_t cal_spins,
+                uint32_t cal_cycles)
+{
+    uint32_t start, cycles, lost, spun;
+
+    start = port_cycles();
+    spun = spins;
+    send();
+    Serial_flush(BENCH_MODULE);
+    spun = spins - spun;
+    cycles = port_cycles() - start;
+
+    // Spins the spinner would have done with the CPU to itself
+    lost = (uint32_t)(((uint64_t)cal_spins * cycles) / cal_cycles);
+    lost = spun < lost ? lost - spun : 0;
+
+    Serial_puts(Serial_module_debug, name);
+    Serial_puts(Serial_module_debug, "\r\n");
+    bench_report("bytes_per_sec",
+                 (uint32_t)(((uint64_t)BENCH_BYTES * F_CPU) / cycles));
+    bench_report("cpu_percent",
+                 (uint32_t)(((uint64_t)lost * 100 * cal_cycles) /
+                            ((uint64_t)cal_spins * cycles)));
+}
+
+int main(void)
+{
+    uint32_t i, start, cal_spins, cal_cycles;
+
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+    Serial_init(BENCH_MODULE, BENCH_BAUD);
+
+    for(i = 0; i < BENCH_BYTES; i++)
+        payload[i] = 'A' + (i % 26);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    sys_spawn(spinner_main, NULL);
+
+    start = port_cycles();
+    cal_spins = spins;
+    sys_sleep(BENCH_CAL_MS);
+    cal_spins = spins - cal_spins;
+    cal_cycles = port_cycles() - start;
+
+    bench_report("baud", BENCH_BAUD);
+    bench_report("bytes", BENCH_BYTES);
+
+    run("polled", send_polled, cal_spins, cal_cycles);
+    run("ring", send_ring, cal_spins, cal_cycles);
+    run("dma", send_dma, cal_spins, cal_cycles);
+
+    sys_reset();
+}
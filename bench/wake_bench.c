@@ -0,0 +1,102 @@
+/*
+ * wake_bench.c
+ *
+ * ISR-to-thread wakeup latency benchmark. A high-resolution timer fires every
+ * BENCH_PERIOD_US; its callback, in interrupt context, stamps the time with
+ * port_cycles() and signals an event. A thread of priority 1 waits on the
+ * event and measures how long after the stamp it got to run, while thread 0,
+ * at priority 0, keeps the CPU busy.
+ *
+ * With KERNEL_WAKE_PREEMPT the waiter runs as soon as the timer ISR returns;
+ * build with --define KERNEL_WAKE_PREEMPT=0 to compare against waiting for
+ * the next scheduler tick. After BENCH_SAMPLES wakeups it reports the
+ * average and worst-case latency, in nanoseconds.
+ */
+
+#include "bench.h"
+#include "board.h"
+#include "drivers/driver_serial.h"
+#include "hrtimer.h"
+#include "kernel.h"
+#include "port.h"
+#include "syscalls.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES (2000)
+#endif
+
+// Not a multiple of the tick, so the wakeups land all over it
+#ifndef BENCH_PERIOD_US
+#define BENCH_PERIOD_US (1300)
+#endif
+
+#define CYCLES_PER_US (F_CPU / 1000000)
+
+static hrtimer_t timer;
+static event_t wake_event;
+static volatile uint32_t wake_stamp;
+
+static volatile uint32_t samples;
+static volatile uint32_t max_latency;
+static volatile uint64_t total_latency;
+
+static void timer_fn(void* ctx)
+{
+    (void) ctx;
+
+    wake_stamp = port_cycles();
+    kernel_event_signal(&wake_event);
+}
+
+int waiter_main(void* arg)
+{
+    uint32_t seen = wake_event, latency;
+
+    (void) arg;
+
+    while(1)
+    {
+        sys_event_wait(&wake_event, seen, EVENT_WAIT_FOREVER);
+        latency = port_cycles() - wake_stamp;
+        seen = wake_event;
+
+        total_latency += latency;
+        if(latency > max_latency)
+            max_latency = latency;
+        samples++;
+    }
+}
+
+int main(void)
+{
+    static const thread_attr_t waiter_attr = {.priority = 1};
+
+    board_init();
+
+    Serial_init(Serial_module_debug, 115200);
+
+    kernel_init(kernel_stack + sizeof(kernel_stack));
+
+    sys_spawn_attr(waiter_main, NULL, &waiter_attr);
+
+    hrtimer_init(&timer, timer_fn, NULL);
+    hrtimer_start(&timer, BENCH_PERIOD_US, BENCH_PERIOD_US);
+
+    // Keep the CPU busy at priority 0 until the samples are in
+    while(samples < BENCH_SAMPLES)
+        ;
+
+    hrtimer_cancel(&timer);
+
+    bench_report("wake_preempt", KERNEL_WAKE_PREEMPT);
+    bench_report("samples", samples);
+    bench_report("avg_ns", (uint32_t)(total_latency * 1000 / CYCLES_PER_US /
+                                      samples));
+    bench_report("max_ns", (uint32_t)((uint64_t) max_latency * 1000 /
+                                      CYCLES_PER_US));
+
+    sys_reset();
+}
@@ -0,0 +1,67 @@
+/*
+ * board.h
+ *
+ * Board support interface. Each directory under boards/ provides one
+ * implementation of these functions, along with the startup code, vector
+ * table, linker script, and console UART for that board. configure.py selects
+ * which board directory is compiled in.
+ */
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Brings the board up to the point where the kernel can run: system
+ * clock configured to F_CPU and any board-level peripherals enabled. Called
+ * from main() before anything else.
+ */
+void board_init(void);
+
+/**
+ * @brief Installs handler for exception number vector (its index in the
+ * vector table; external interrupt n is vector 16 + n) and enables it in the
+ * NVIC. The first call copies the flash vector table into the RAM table in
+ * the .vtable section and points VTOR at it. Not available on the host
+ * board, which has no interrupts.
+ */
+void board_irq_register(uint32_t vector, void (*handler)(void));
+
+/**
+ * @brief Sets up the high-resolution timer: a one-shot down counter clocked
+ * at F_CPU whose interrupt handler acknowledges it and calls hrtimer_isr().
+ * Called by hrtimer.c before the first use.
+ */
+void board_hrtimer_init(void);
+
+/**
+ * @brief Starts the high-resolution timer to interrupt once, cycles from
+ * now, replacing any earlier deadline.
+ */
+void board_hrtimer_arm(uint32_t cycles);
+
+/**
+ * @brief Stops the high-resolution timer, if it is running.
+ */
+void board_hrtimer_stop(void);
+
+/**
+ * @brief Starts the latency probe: a periodic timer, separate from the
+ * high-resolution timer, that interrupts every cycles cycles and calls
+ * fn(late) from its handler, late being how many cycles after the timer
+ * expired the handler started. With zero_latency the interrupt gets a
+ * priority above PORT_KERNEL_PRIORITY, and fn must not call into the kernel;
+ * otherwise it is at the kernel's priority, and waits for the kernel and for
+ * critical_enter() sections. Used by bench/irq_bench.c.
+ */
+void board_probe_start(uint32_t cycles, bool zero_latency,
+                       void (*fn)(uint32_t late));
+
+/**
+ * @brief Stops the latency probe.
+ */
+void board_probe_stop(void);
+
+#endif /* BOARD_H_ */
@@ -0,0 +1,133 @@
+/**
+ * @brief Board support for the host simulation (configure.py --board host).
+ * There is no hardware to bring up. The high-resolution timer and the latency
+ * probe are POSIX timers whose signals stand in for their interrupts.
+ */
+
+#define _GNU_SOURCE
+
+#include "board.h"
+#include "hrtimer.h"
+#include "port.h"
+#include "port/host/port_host.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+static timer_t board_hrtimer;
+
+// The latency probe's signal when it is not a zero-latency interrupt
+#define BOARD_PROBE_SIGNAL (SIGRTMIN + 2)
+
+static timer_t board_probe;
+static uint32_t board_probe_period;
+static void (*board_probe_fn)(uint32_t late);
+
+static void board_hrtimer_handler(int sig)
+{
+    (void) sig;
+
+    port_clear_exclusive();
+    hrtimer_isr();
+    port_isr_exit();
+}
+
+void board_init(void)
+{
+}
+
+void board_hrtimer_init(void)
+{
+    struct sigaction sa;
+    struct sigevent sev;
+
+    // The kernel runs with every signal blocked. The tick is blocked here
+    // too, since it could switch threads in the middle of the handler.
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = board_hrtimer_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaddset(&sa.sa_mask, PORT_TICK_SIGNAL);
+    sigaction(SIGRTMIN, &sa, NULL);
+
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = SIGRTMIN;
+    timer_create(CLOCK_MONOTONIC, &sev, &board_hrtimer);
+}
+
+void board_hrtimer_arm(uint32_t cycles)
+{
+    struct itimerspec its;
+
+    // F_CPU is 1 GHz on the host, so cycles are nanoseconds
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = cycles / 1000000000u;
+    its.it_value.tv_nsec = cycles ? cycles % 1000000000u : 1;
+    timer_settime(board_hrtimer, 0, &its, NULL);
+}
+
+void board_hrtimer_stop(void)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    timer_settime(board_hrtimer, 0, &its, NULL);
+}
+
+static void board_probe_handler(int sig)
+{
+    struct itimerspec its;
+    uint32_t remaining;
+
+    (void) sig;
+
+    port_clear_exclusive();
+
+    // F_CPU is 1 GHz on the host, so cycles are nanoseconds
+    timer_gettime(board_probe, &its);
+    remaining = its.it_value.tv_sec * 1000000000u + its.it_value.tv_nsec;
+    board_probe_fn(remaining < board_probe_period ?
+                   board_probe_period - remaining : 0);
+}
+
+void board_probe_start(uint32_t cycles, bool zero_latency,
+                       void (*fn)(uint32_t late))
+{
+    struct sigaction sa;
+    struct sigevent sev;
+    struct itimerspec its;
+    int sig = zero_latency ? PORT_ZERO_LATENCY_SIGNAL : BOARD_PROBE_SIGNAL;
+
+    board_probe_fn = fn;
+    board_probe_period = cycles;
+
+    // At the kernel's priority, the handler keeps the tick out as
+    // board_hrtimer_handler() does; a zero-latency one cannot call into the
+    // kernel, so the tick may come and go
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = board_probe_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if(!zero_latency)
+        sigaddset(&sa.sa_mask, PORT_TICK_SIGNAL);
+    sigaction(sig, &sa, NULL);
+
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = sig;
+    timer_create(CLOCK_MONOTONIC, &sev, &board_probe);
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = cycles / 1000000000u;
+    its.it_value.tv_nsec = cycles % 1000000000u;
+    its.it_interval = its.it_value;
+    timer_settime(board_probe, 0, &its, NULL);
+}
+
+void board_probe_stop(void)
+{
+    timer_delete(board_probe);
+}
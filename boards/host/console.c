@@ -0,0 +1,123 @@
+/**
+ * @brief Implementation of the driver_serial interface for the host
+ * simulation. Every module is connected to the process's stdin and stdout.
+ */
+
+#include "drivers/driver_serial.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+void Serial_init(Serial_module_e module, uint32_t baud)
+{
+    (void) module;
+    (void) baud;
+}
+
+void Serial_putc(Serial_module_e module, char c)
+{
+    Serial_writebuf(module, (const uint8_t*) &c, 1);
+}
+
+bool Serial_avail(Serial_module_e module)
+{
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+
+    (void) module;
+    return poll(&pfd, 1, 0) == 1;
+}
+
+int Serial_getc(Serial_module_e module)
+{
+    uint8_t c;
+
+    if (!Serial_avail(module) || read(STDIN_FILENO, &c, 1) != 1)
+        return -1;
+    return (int) c;
+}
+
+void Serial_puts(Serial_module_e module, const char * s)
+{
+    Serial_writebuf(module, (const uint8_t*) s, strlen(s));
+}
+
+void Serial_writebuf(Serial_module_e module, const uint8_t* buf, uint32_t len)
+{
+    ssize_t n;
+
+    (void) module;
+    while (len > 0)
+    {
+        n = write(STDOUT_FILENO, buf, len);
+        if (n <= 0)
+            return;
+        buf += n;
+        len -= n;
+    }
+}
+
+void Serial_flush(Serial_module_e module)
+{
+    (void) module;
+}
+
+/*
+ * No DMA on this board: the transfer is sent synchronously and is complete
+ * by the time Serial_write_async() returns.
+ */
+void Serial_write_async(Serial_module_e module, const uint8_t* buf,
+                        uint32_t len, Serial_xfer_t* xfer)
+{
+    xfer->buf = buf;
+    xfer->len = len;
+    xfer->module = module;
+    xfer->next = NULL;
+    Serial_writebuf(module, buf, len);
+    xfer->sent = len;
+    xfer->done = true;
+}
+
+bool Serial_xfer_done(const Serial_xfer_t* xfer)
+{
+    return xfer->done;
+}
+
+void Serial_xfer_wait(Serial_xfer_t* xfer)
+{
+    (void) xfer;
+}
+
+/*
+ * No receive interrupt on this board: poll, sleeping a scheduler tick
+ * between attempts while the kernel is running.
+ */
+uint32_t Serial_read(Serial_module_e module, uint8_t* buf, uint32_t len,
+                     uint32_t timeout_ms)
+{
+    uint32_t n = 0;
+    int c;
+
+    while (1)
+    {
+        while (n < len && (c = Serial_getc(module)) >= 0)
+            buf[n++] = (uint8_t) c;
+
+        if (n || !timeout_ms || thread_current == NULL)
+            return n;
+
+        sys_sleep(1);
+        if (timeout_ms != EVENT_WAIT_FOREVER)
+            timeout_ms--;
+    }
+}
+
+uint32_t Serial_rx_dropped(Serial_module_e module)
+{
+    (void) module;
+    return 0;
+}
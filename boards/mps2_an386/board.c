@@ -0,0 +1,119 @@
+/**
+ * @brief Board support for the ARM MPS2 AN386 image (QEMU mps2-an386).
+ *
+ * The FPGA image has a fixed 25 MHz system clock, so there is nothing to
+ * configure here; F_CPU is set to match by configure.py.
+ */
+
+#include "board.h"
+#include "hrtimer.h"
+#include "mps2_an386.h"
+#include "os_utils.h"
+#include "port.h"
+#include "trace.h"
+
+#include <stdint.h>
+
+// Vector table offset and interrupt set-enable registers [ARM: B3.2.5, B3.4.4]
+#define SCB_VTOR   (0xE000ED08)
+#define NVIC_ISER0 (0xE000E100)
+
+// The high-resolution timer; the CMSDK timer has no one-shot mode, so the
+// interrupt handler stops it
+#define BOARD_HRTIMER_BASE (MPS2_TIMER0_BASE)
+
+// The latency probe, and its priority when it is a zero-latency interrupt
+#define BOARD_PROBE_BASE (MPS2_TIMER1_BASE)
+#define BOARD_PROBE_PRIORITY (0x00)
+
+static void (*board_probe_fn)(uint32_t late);
+
+extern void (* const g_pfnVectors[])(void);
+
+/*
+ * RAM copy of the vector table. VTOR needs the table aligned to its size
+ * rounded up to a power of two.
+ */
+__attribute__((section(".vtable"), aligned(256)))
+static void (*ram_vectors[MPS2_NUM_VECTORS])(void);
+
+void board_init(void)
+{
+}
+
+void board_irq_register(uint32_t vector, void (*handler)(void))
+{
+    uint32_t i;
+
+    if (dptr(SCB_VTOR) != (uint32_t) ram_vectors)
+    {
+        for (i = 0; i < MPS2_NUM_VECTORS; i++)
+            ram_vectors[i] = g_pfnVectors[i];
+        asm volatile("dsb" : : : "memory");
+        dptr(SCB_VTOR) = (uint32_t) ram_vectors;
+        asm volatile("dsb\r\nisb" : : : "memory");
+    }
+
+    ram_vectors[vector] = handler;
+
+    if (vector >= 16)
+        dptr(NVIC_ISER0 + ((vector - 16) / 32) * 4) = 1 << ((vector - 16) % 32);
+}
+
+void board_hrtimer_init(void)
+{
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_CTRL) = 0;
+    dptr(NVIC_ISER0) = 1 << MPS2_IRQ_TIMER0;
+}
+
+void board_hrtimer_arm(uint32_t cycles)
+{
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_CTRL) = 0;
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_RELOAD) = cycles ? cycles : 1;
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_VALUE) = cycles ? cycles : 1;
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_CTRL) =
+            CMSDK_TIMER_CTRL_EN | CMSDK_TIMER_CTRL_IE;
+}
+
+void board_hrtimer_stop(void)
+{
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_CTRL) = 0;
+}
+
+void board_hrtimer_isr(void)
+{
+    trace_isr(MPS2_IRQ_TIMER0);
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_CTRL) = 0;
+    dptr(BOARD_HRTIMER_BASE + CMSDK_TIMER_INTCLEAR) = 1;
+    hrtimer_isr();
+}
+
+static void board_probe_isr(void)
+{
+    // The timer reloaded when it expired and has been counting down since
+    uint32_t late = dptr(BOARD_PROBE_BASE + CMSDK_TIMER_RELOAD) -
+                    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_VALUE);
+
+    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_INTCLEAR) = 1;
+    board_probe_fn(late);
+}
+
+void board_probe_start(uint32_t cycles, bool zero_latency,
+                       void (*fn)(uint32_t late))
+{
+    board_probe_fn = fn;
+
+    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_CTRL) = 0;
+    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_RELOAD) = cycles - 1;
+    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_VALUE) = cycles - 1;
+    port_irq_set_priority(MPS2_IRQ_TIMER1, zero_latency ?
+                          BOARD_PROBE_PRIORITY : PORT_KERNEL_PRIORITY);
+    board_irq_register(16 + MPS2_IRQ_TIMER1, board_probe_isr);
+    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_CTRL) =
+            CMSDK_TIMER_CTRL_EN | CMSDK_TIMER_CTRL_IE;
+}
+
+void board_probe_stop(void)
+{
+    dptr(BOARD_PROBE_BASE + CMSDK_TIMER_CTRL) = 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * mps2_an386.h
+ *
+ * Memory map and interrupt numbers for the ARM MPS2 AN386 (Cortex-M4) FPGA
+ * image, as modelled by QEMU's mps2-an386 machine. Bracketed references refer
+ * to the application note:
+ *
+ * [AN386: X] => ARM Application Note AN386, section X
+ * [CMSDK: X] => Cortex-M System Design Kit Technical Reference Manual,
+ *               section X
+ */
+
+#ifndef MPS2_AN386_H_
+#define MPS2_AN386_H_
+
+// CMSDK APB peripherals [AN386: 3.8]
+#define MPS2_TIMER0_BASE        (0x40000000)
+#define MPS2_TIMER1_BASE        (0x40001000)
+#define MPS2_DUALTIMER_BASE     (0x40002000)
+#define MPS2_UART0_BASE         (0x40004000)
+#define MPS2_UART1_BASE         (0x40005000)
+#define MPS2_UART2_BASE         (0x40006000)
+#define MPS2_UART3_BASE         (0x40007000)
+#define MPS2_UART4_BASE         (0x40009000)
+
+// 16 system exceptions followed by 32 external interrupts [AN386: 3.9]
+#define MPS2_NUM_VECTORS        (16 + 32)
+
+// External interrupt numbers [AN386: 3.9]
+#define MPS2_IRQ_UART0_RX       (0)
+#define MPS2_IRQ_UART0_TX       (1)
+#define MPS2_IRQ_UART1_RX       (2)
+#define MPS2_IRQ_UART1_TX       (3)
+#define MPS2_IRQ_UART2_RX       (4)
+#define MPS2_IRQ_UART2_TX       (5)
+#define MPS2_IRQ_TIMER0         (8)
+#define MPS2_IRQ_TIMER1         (9)
+#define MPS2_IRQ_DUALTIMER      (10)
+#define MPS2_IRQ_UART_OVF       (12)
+#define MPS2_IRQ_UART3_RX       (18)
+#define MPS2_IRQ_UART3_TX       (19)
+#define MPS2_IRQ_UART4_RX       (20)
+#define MPS2_IRQ_UART4_TX       (21)
+#define MPS2_NUM_IRQS           (32)
+
+// CMSDK APB UART registers [CMSDK: 4.3]
+#define CMSDK_UART_DATA         (0x000)
+#define CMSDK_UART_STATE        (0x004)
+#define CMSDK_UART_CTRL         (0x008)
+#define CMSDK_UART_INTSTATUS    (0x00C)
+#define CMSDK_UART_INTCLEAR     (0x00C)
+#define CMSDK_UART_BAUDDIV      (0x010)
+
+#define CMSDK_UART_STATE_TXFULL (0x01)
+#define CMSDK_UART_STATE_RXFULL (0x02)
+
+#define CMSDK_UART_CTRL_TXEN    (0x01)
+#define CMSDK_UART_CTRL_RXEN    (0x02)
+#define CMSDK_UART_CTRL_TXIE    (0x04)
+#define CMSDK_UART_CTRL_RXIE    (0x08)
+
+#define CMSDK_UART_INT_TX       (0x01)
+#define CMSDK_UART_INT_RX       (0x02)
+
+// CMSDK APB timer registers [CMSDK: 4.4]
+#define CMSDK_TIMER_CTRL        (0x000)
+#define CMSDK_TIMER_VALUE       (0x004)
+#define CMSDK_TIMER_RELOAD      (0x008)
+#define CMSDK_TIMER_INTCLEAR    (0x00C)
+
+#define CMSDK_TIMER_CTRL_EN     (0x01)
+#define CMSDK_TIMER_CTRL_IE     (0x08)
+
+#endif /* MPS2_AN386_H_ */
@@ -0,0 +1,223 @@
+/**
+ * @brief Startup code for the ARM MPS2 AN386 image (Cortex-M4F), as run by
+ * QEMU's mps2-an386 machine.
+ *
+ * Bracketed references refer to mps2_an386.h.
+ */
+
+#include "inc/hw_nvic.h"
+#include "inc/hw_types.h"
+
+#include "drivers/driver_serial.h"
+#include "mps2_an386.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+__attribute__((noreturn))
+extern void kernel_entry(void);
+
+//*****************************************************************************
+//
+// Forward declaration of the default fault handlers.
+//
+//*****************************************************************************
+void ResetISR(void);
+static void NmiSR(void);
+static void FaultISR(void);
+static void IntDefaultHandler(void);
+
+//*****************************************************************************
+//
+// The entry point for the application.
+//
+//*****************************************************************************
+extern int main(void);
+
+extern uint8_t kernel_stack[1024];
+
+extern void board_hrtimer_isr(void);
+
+//*****************************************************************************
+//
+// The vector table. QEMU loads main.elf and takes the initial stack pointer
+// and reset vector from address 0x0000.0000 [AN386: 3.2].
+//
+//*****************************************************************************
+__attribute__ ((section(".isr_vector")))
+void (* const g_pfnVectors[])(void) =
+{
+    (void (*)(void))((uint32_t)kernel_stack + sizeof(kernel_stack)),
+                                            // The initial stack pointer
+    ResetISR,                               // The reset handler
+    NmiSR,                                  // The NMI handler
+    FaultISR,                               // The hard fault handler
+    IntDefaultHandler,                      // The MPU fault handler
+    IntDefaultHandler,                      // The bus fault handler
+    IntDefaultHandler,                      // The usage fault handler
+    0,                                      // Reserved
+    0,                                      // Reserved
+    0,                                      // Reserved
+    0,                                      // Reserved
+    // Needs to be kernel_entry + 1 to keep the processor in Thumb state on
+    // exception entry (see boards/tm4c123/startup.c)
+    kernel_entry + 1,                       // SVCall handler
+    IntDefaultHandler,                      // Debug monitor handler
+    0,                                      // Reserved
+    kernel_entry + 1,                       // The PendSV handler
+    kernel_entry + 1,                       // The SysTick handler
+    IntDefaultHandler,                      // UART0 Rx
+    IntDefaultHandler,                      // UART0 Tx
+    IntDefaultHandler,                      // UART1 Rx
+    IntDefaultHandler,                      // UART1 Tx
+    IntDefaultHandler,                      // UART2 Rx
+    IntDefaultHandler,                      // UART2 Tx
+    IntDefaultHandler,                      // GPIO 0 combined
+    IntDefaultHandler,                      // GPIO 1 combined
+    board_hrtimer_isr,                      // Timer 0
+    IntDefaultHandler,                      // Timer 1
+    IntDefaultHandler,                      // Dual timer
+    IntDefaultHandler,                      // SPI
+    IntDefaultHandler,                      // UART 0-2 overflow
+    IntDefaultHandler,                      // Ethernet
+    IntDefaultHandler,                      // Audio I2S
+    IntDefaultHandler,                      // Touch screen
+    IntDefaultHandler,                      // GPIO 2 combined
+    IntDefaultHandler,                      // GPIO 3 combined
+    IntDefaultHandler,                      // UART3 Rx
+    IntDefaultHandler,                      // UART3 Tx
+    IntDefaultHandler,                      // UART4 Rx
+    IntDefaultHandler,                      // UART4 Tx
+    IntDefaultHandler,                      // SPI 2
+    IntDefaultHandler,                      // SPI 3-4
+    IntDefaultHandler,                      // GPIO 0 pin 0
+    IntDefaultHandler,                      // GPIO 0 pin 1
+    IntDefaultHandler,                      // GPIO 0 pin 2
+    IntDefaultHandler,                      // GPIO 0 pin 3
+    IntDefaultHandler,                      // GPIO 0 pin 4
+    IntDefaultHandler,                      // GPIO 0 pin 5
+    IntDefaultHandler,                      // GPIO 0 pin 6
+    IntDefaultHandler                       // GPIO 0 pin 7
+};
+
+//*****************************************************************************
+//
+// Constructs created by the linker, indicating where the "data" and "bss"
+// segments reside in memory, and where the "data" initializers are loaded.
+//
+//*****************************************************************************
+extern uint32_t __data_load__;
+extern uint32_t __data_start__;
+extern uint32_t __data_end__;
+extern uint32_t __bss_start__;
+extern uint32_t __bss_end__;
+
+//*****************************************************************************
+//
+// This is the code that gets called when the processor first starts execution
+// following a reset event.
+//
+//*****************************************************************************
+void
+ResetISR(void)
+{
+    uint32_t *pui32Src, *pui32Dest;
+
+    //
+    // Copy the data segment initializers into place. QEMU loads the ELF
+    // segments at their load addresses, same as a flash programmer would.
+    //
+    pui32Src = &__data_load__;
+    for(pui32Dest = &__data_start__; pui32Dest < &__data_end__; )
+    {
+        *pui32Dest++ = *pui32Src++;
+    }
+
+    //
+    // Zero fill the bss segment.
+    //
+    for(pui32Dest = &__bss_start__; pui32Dest < &__bss_end__; )
+    {
+        *pui32Dest++ = 0;
+    }
+
+    //
+    // Enable the floating-point unit before main() can touch it; see the
+    // matching comment in boards/tm4c123/startup.c.
+    //
+    HWREG(NVIC_CPAC) = ((HWREG(NVIC_CPAC) &
+                         ~(NVIC_CPAC_CP10_M | NVIC_CPAC_CP11_M)) |
+                         NVIC_CPAC_CP10_FULL | NVIC_CPAC_CP11_FULL);
+
+    //
+    // Call the application's entry point.
+    //
+    main();
+}
+
+/* syscall stuff */
+void *__dso_handle = 0;
+
+/**
+ * _sbrk - newlib memory allocation routine
+ */
+typedef char *caddr_t;
+
+caddr_t _sbrk (int incr)
+{
+    double current_sp;
+    extern char end asm ("end"); /* Defined by linker */
+    static char * heap_end;
+    char * prev_heap_end;
+
+    if (heap_end == NULL) {
+        heap_end = &end; /* first ram address after bss and data */
+    }
+
+    prev_heap_end = heap_end;
+
+    if ( heap_end + incr < (caddr_t)&current_sp ) {
+        heap_end += incr;
+        return (caddr_t) prev_heap_end;
+    }
+    else {
+        return NULL;
+    }
+}
+
+//*****************************************************************************
+//
+// Fault and unexpected-interrupt handlers. These report over the console UART
+// and then spin, preserving the system state for a debugger attached to
+// QEMU's gdbstub.
+//
+//*****************************************************************************
+static void
+NmiSR(void)
+{
+    Serial_puts(Serial_module_debug, "NMI\r\n");
+
+    while(1)
+    {
+    }
+}
+
+static void
+FaultISR(void)
+{
+    Serial_puts(Serial_module_debug, "FAULT\r\n");
+
+    while(1)
+    {
+    }
+}
+
+static void
+IntDefaultHandler(void)
+{
+    Serial_puts(Serial_module_debug, "DEFAULT\r\n");
+
+    while(1)
+    {
+    }
+}
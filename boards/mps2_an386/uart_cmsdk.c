@@ -0,0 +1,134 @@
+/**
+ * @brief Implementation of the driver_serial interface on the CMSDK APB UARTs
+ * of the MPS2 AN386 image. Only modules 0-4 exist on this board.
+ */
+
+#include "drivers/driver_serial.h"
+#include "mps2_an386.h"
+#include "os_utils.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MPS2_NUM_UARTS (5)
+
+static const uint32_t uart_bases[MPS2_NUM_UARTS] =
+{
+    MPS2_UART0_BASE,
+    MPS2_UART1_BASE,
+    MPS2_UART2_BASE,
+    MPS2_UART3_BASE,
+    MPS2_UART4_BASE,
+};
+
+#define uart_reg(_module_, _reg_) dptr(uart_bases[(_module_)] + (_reg_))
+
+void Serial_init(Serial_module_e module, uint32_t baud)
+{
+    if (module >= MPS2_NUM_UARTS)
+        return;
+
+    // The baud divider must be at least 16 [CMSDK: 4.3]
+    uint32_t div = F_CPU / baud;
+    uart_reg(module, CMSDK_UART_BAUDDIV) = (div < 16) ? 16 : div;
+    uart_reg(module, CMSDK_UART_CTRL) = CMSDK_UART_CTRL_TXEN |
+                                        CMSDK_UART_CTRL_RXEN;
+}
+
+void Serial_putc(Serial_module_e module, char c)
+{
+    while (uart_reg(module, CMSDK_UART_STATE) & CMSDK_UART_STATE_TXFULL)
+        ;
+    uart_reg(module, CMSDK_UART_DATA) = (uint8_t) c;
+}
+
+bool Serial_avail(Serial_module_e module)
+{
+    return (uart_reg(module, CMSDK_UART_STATE) & CMSDK_UART_STATE_RXFULL) != 0;
+}
+
+int Serial_getc(Serial_module_e module)
+{
+    if (!Serial_avail(module))
+        return -1;
+    return (int) (uart_reg(module, CMSDK_UART_DATA) & 0xFF);
+}
+
+void Serial_puts(Serial_module_e module, const char * s)
+{
+    while (*s)
+        Serial_putc(module, *s++);
+}
+
+void Serial_writebuf(Serial_module_e module, const uint8_t* buf, uint32_t len)
+{
+    uint32_t i;
+    for (i = 0; i < len; i++)
+        Serial_putc(module, buf[i]);
+}
+
+void Serial_flush(Serial_module_e module)
+{
+    // The CMSDK UART has a single-byte holding register and no busy flag;
+    // waiting for it to drain is the best we can do.
+    while (uart_reg(module, CMSDK_UART_STATE) & CMSDK_UART_STATE_TXFULL)
+        ;
+}
+
+/*
+ * No DMA on this board: the transfer is sent synchronously and is complete
+ * by the time Serial_write_async() returns.
+ */
+void Serial_write_async(Serial_module_e module, const uint8_t* buf,
+                        uint32_t len, Serial_xfer_t* xfer)
+{
+    xfer->buf = buf;
+    xfer->len = len;
+    xfer->module = module;
+    xfer->next = NULL;
+    Serial_writebuf(module, buf, len);
+    xfer->sent = len;
+    xfer->done = true;
+}
+
+bool Serial_xfer_done(const Serial_xfer_t* xfer)
+{
+    return xfer->done;
+}
+
+void Serial_xfer_wait(Serial_xfer_t* xfer)
+{
+    (void) xfer;
+}
+
+/*
+ * No receive interrupt on this board: poll, sleeping a scheduler tick
+ * between attempts while the kernel is running.
+ */
+uint32_t Serial_read(Serial_module_e module, uint8_t* buf, uint32_t len,
+                     uint32_t timeout_ms)
+{
+    uint32_t n = 0;
+    int c;
+
+    while (1)
+    {
+        while (n < len && (c = Serial_getc(module)) >= 0)
+            buf[n++] = (uint8_t) c;
+
+        if (n || !timeout_ms || thread_current == NULL)
+            return n;
+
+        sys_sleep(1);
+        if (timeout_ms != EVENT_WAIT_FOREVER)
+            timeout_ms--;
+    }
+}
+
+uint32_t Serial_rx_dropped(Serial_module_e module)
+{
+    (void) module;
+    return 0;
+}
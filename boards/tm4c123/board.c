@@ -0,0 +1,106 @@
+/**
+ * @brief Board support for the TM4C123GXL LaunchPad (TM4C123GH6PM).
+ */
+
+#include "board.h"
+#include "hrtimer.h"
+#include "port.h"
+#include "trace.h"
+
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The high-resolution timer: Timer 0, full width, one-shot
+#define BOARD_HRTIMER_BASE (TIMER0_BASE)
+
+// The latency probe: Timer 1, full width, periodic, and its priority when it
+// is a zero-latency interrupt
+#define BOARD_PROBE_BASE (TIMER1_BASE)
+#define BOARD_PROBE_PRIORITY (0x00)
+
+static void (*board_probe_fn)(uint32_t late);
+
+void board_init(void)
+{
+    // 16 MHz crystal -> 400 MHz PLL / 2 / 2.5 = 80 MHz (F_CPU)
+    SysCtlClockSet(SYSCTL_SYSDIV_2_5 | SYSCTL_USE_PLL | SYSCTL_XTAL_16MHZ
+                   | SYSCTL_OSC_MAIN);
+}
+
+void board_irq_register(uint32_t vector, void (*handler)(void))
+{
+    // IntRegister() keeps its RAM table in the "vtable" section, which the
+    // linker script places at the start of SRAM
+    IntRegister(vector, handler);
+    IntEnable(vector);
+}
+
+void board_hrtimer_init(void)
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+    while(!SysCtlPeripheralReady(SYSCTL_PERIPH_TIMER0))
+        ;
+
+    TimerConfigure(BOARD_HRTIMER_BASE, TIMER_CFG_ONE_SHOT);
+    TimerIntEnable(BOARD_HRTIMER_BASE, TIMER_TIMA_TIMEOUT);
+    IntEnable(INT_TIMER0A);
+}
+
+void board_hrtimer_arm(uint32_t cycles)
+{
+    TimerDisable(BOARD_HRTIMER_BASE, TIMER_A);
+    TimerLoadSet(BOARD_HRTIMER_BASE, TIMER_A, cycles ? cycles : 1);
+    TimerEnable(BOARD_HRTIMER_BASE, TIMER_A);
+}
+
+void board_hrtimer_stop(void)
+{
+    TimerDisable(BOARD_HRTIMER_BASE, TIMER_A);
+}
+
+void board_hrtimer_isr(void)
+{
+    trace_isr(INT_TIMER0A);
+    TimerIntClear(BOARD_HRTIMER_BASE, TIMER_TIMA_TIMEOUT);
+    hrtimer_isr();
+}
+
+static void board_probe_isr(void)
+{
+    // The timer reloaded when it expired and has been counting down since
+    uint32_t late = TimerLoadGet(BOARD_PROBE_BASE, TIMER_A) -
+                    TimerValueGet(BOARD_PROBE_BASE, TIMER_A);
+
+    TimerIntClear(BOARD_PROBE_BASE, TIMER_TIMA_TIMEOUT);
+    board_probe_fn(late);
+}
+
+void board_probe_start(uint32_t cycles, bool zero_latency,
+                       void (*fn)(uint32_t late))
+{
+    board_probe_fn = fn;
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+    while(!SysCtlPeripheralReady(SYSCTL_PERIPH_TIMER1))
+        ;
+
+    TimerConfigure(BOARD_PROBE_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(BOARD_PROBE_BASE, TIMER_A, cycles - 1);
+    TimerIntEnable(BOARD_PROBE_BASE, TIMER_TIMA_TIMEOUT);
+    port_irq_set_priority(INT_TIMER1A - 16, zero_latency ?
+                          BOARD_PROBE_PRIORITY : PORT_KERNEL_PRIORITY);
+    board_irq_register(INT_TIMER1A, board_probe_isr);
+    TimerEnable(BOARD_PROBE_BASE, TIMER_A);
+}
+
+void board_probe_stop(void)
+{
+    TimerDisable(BOARD_PROBE_BASE, TIMER_A);
+    TimerIntDisable(BOARD_PROBE_BASE, TIMER_TIMA_TIMEOUT);
+}
@@ -45,6 +45,15 @@ extern uint8_t kernel_stack[1024];
 //
 //*****************************************************************************
 // To be added by user
+extern void Serial_ISR0(void);
+extern void Serial_ISR1(void);
+extern void Serial_ISR2(void);
+extern void Serial_ISR3(void);
+extern void Serial_ISR4(void);
+extern void Serial_ISR5(void);
+extern void Serial_ISR6(void);
+extern void Serial_ISR7(void);
+extern void board_hrtimer_isr(void);
 
 //*****************************************************************************
 //
@@ -73,15 +82,15 @@ void (* const g_pfnVectors[])(void) =
     kernel_entry + 1,                       // SVCall handler
     IntDefaultHandler,                      // Debug monitor handler
     0,                                      // Reserved
-    IntDefaultHandler,                      // The PendSV handler
+    kernel_entry + 1,                       // The PendSV handler
     kernel_entry + 1,                       // The SysTick handler
     IntDefaultHandler,                      // GPIO Port A
     IntDefaultHandler,                      // GPIO Port B
     IntDefaultHandler,                      // GPIO Port C
     IntDefaultHandler,                      // GPIO Port D
     IntDefaultHandler,                      // GPIO Port E
-    IntDefaultHandler,                      // UART0 Rx and Tx
-    IntDefaultHandler,                      // UART1 Rx and Tx
+    Serial_ISR0,                            // UART0 Rx and Tx
+    Serial_ISR1,                            // UART1 Rx and Tx
     IntDefaultHandler,                      // SSI0 Rx and Tx
     IntDefaultHandler,                      // I2C0 Master and Slave
     IntDefaultHandler,                      // PWM Fault
@@ -94,7 +103,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // ADC Sequence 2
     IntDefaultHandler,                      // ADC Sequence 3
     IntDefaultHandler,                      // Watchdog timer
-    IntDefaultHandler,                      // Timer 0 subtimer A
+    board_hrtimer_isr,                      // Timer 0 subtimer A
     IntDefaultHandler,                      // Timer 0 subtimer B
     IntDefaultHandler,                      // Timer 1 subtimer A
     IntDefaultHandler,                      // Timer 1 subtimer B
@@ -108,7 +117,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // GPIO Port F
     IntDefaultHandler,                      // GPIO Port G
     IntDefaultHandler,                      // GPIO Port H
-    IntDefaultHandler,                      // UART2 Rx and Tx
+    Serial_ISR2,                            // UART2 Rx and Tx
     IntDefaultHandler,                      // SSI1 Rx and Tx
     IntDefaultHandler,                      // Timer 3 subtimer A
     IntDefaultHandler,                      // Timer 3 subtimer B
@@ -134,11 +143,11 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // GPIO Port L
     IntDefaultHandler,                      // SSI2 Rx and Tx
     IntDefaultHandler,                      // SSI3 Rx and Tx
-    IntDefaultHandler,                      // UART3 Rx and Tx
-    IntDefaultHandler,                      // UART4 Rx and Tx
-    IntDefaultHandler,                      // UART5 Rx and Tx
-    IntDefaultHandler,                      // UART6 Rx and Tx
-    IntDefaultHandler,                      // UART7 Rx and Tx
+    Serial_ISR3,                            // UART3 Rx and Tx
+    Serial_ISR4,                            // UART4 Rx and Tx
+    Serial_ISR5,                            // UART5 Rx and Tx
+    Serial_ISR6,                            // UART6 Rx and Tx
+    Serial_ISR7,                            // UART7 Rx and Tx
     0,                                      // Reserved
     0,                                      // Reserved
     0,                                      // Reserved
@@ -1,16 +1,68 @@
 #!/usr/bin/python
 
 from ninja_syntax import Writer
-import os, sys
+import argparse, os, sys
 
-source_dirs = [
-        ".",
-        "driverlib",
-        "inc",
-        "drivers"
+# Directories compiled into every build. main.c in the root is the default
+# application; --app replaces it.
+common_source_dirs = [
+        "."
 ]
 
-include_dirs = source_dirs
+# CPU ports: toolchain, source directories and code generation flags.
+ports = {
+    "cortex_m" : {
+        "prefix" : "arm-none-eabi-",
+        "source_dirs" : ["port/cortex_m"],
+        "asm" : True,
+        "cflags" : ("-mthumb -mcpu=cortex-m4 -mfloat-abi=hard " +
+                    "-mfpu=fpv4-sp-d16 -fsingle-precision-constant"),
+        "lflags" : ("-nostartfiles -Wl,--entry=ResetISR -mthumb " +
+                    "-mcpu=cortex-m4 -mfloat-abi=hard -mfpu=fpv4-sp-d16 " +
+                    "-fsingle-precision-constant -lm -lstdc++ -lc"),
+    },
+    "host" : {
+        "prefix" : "",
+        "source_dirs" : ["port/host"],
+        "asm" : False,
+        "cflags" : "-DPORT_HOST",
+        # Non-PIE, so that sampled PCs match the addresses in main.elf
+        "lflags" : "-no-pie -lm",
+    },
+}
+
+# Per-board port, source directories, compiler definitions, and linker
+# script.
+boards = {
+    "tm4c123" : {
+        "port" : "cortex_m",
+        "source_dirs" : ["driverlib", "inc", "drivers", "boards/tm4c123"],
+        "defines" : "-DF_CPU=80000000L -DPART_TM4C123GH6PM",
+        "ldscript" : "boards/tm4c123/tm4c123gh6pm.ld",
+    },
+    "mps2_an386" : {
+        "port" : "cortex_m",
+        "source_dirs" : ["boards/mps2_an386"],
+        "defines" : "-DF_CPU=25000000L -DBOARD_MPS2_AN386",
+        "ldscript" : "boards/mps2_an386/mps2_an386.ld",
+    },
+    # Runs the kernel as a Linux process; see port/host. Thread stacks are
+    # much larger here since host library code is not written for 1 KB.
+    "host" : {
+        "port" : "host",
+        "source_dirs" : ["boards/host"],
+        "defines" : ("-DF_CPU=1000000000L -DBOARD_HOST " +
+                     "-DLOG2_THREAD_MEM_SIZE=16 -DKERNEL_STACKSIZE=65536"),
+        "ldscript" : None,
+    },
+}
+
+board = None
+port = None
+app = "main.c"
+extra_defines = ""
+source_dirs = common_source_dirs
+include_dirs = [".", "driverlib", "inc", "drivers"]
 
 def subst_ext(fname, ext):
     return os.path.splitext(fname)[0] + ext
@@ -19,52 +71,57 @@ def get_sources():
     fnames = []
     for d in source_dirs:
         for f in os.listdir(d):
-            fnames.append(os.path.join(d, f))
-    return fnames
+            fnames.append(os.path.normpath(os.path.join(d, f)))
+    fnames = [f for f in fnames
+              if f != "main.c" and f != os.path.normpath(app)]
+    if not port["asm"]:
+        fnames = [f for f in fnames if not f.endswith(".S")]
+    return fnames + [os.path.normpath(app)]
 
 def get_includes():
     return " ".join(map(lambda x : "-I"+x, include_dirs))
 
-cflags = ("-g -c -Os -ffunction-sections -fdata-sections " +
-         "-mthumb -mcpu=cortex-m4 -mfloat-abi=hard " +
-         "-mfpu=fpv4-sp-d16 -fsingle-precision-constant " +
-         "-DF_CPU=80000000L -DPART_TM4C123GH6PM " +
-         get_includes())
+def get_defines():
+    return board["defines"] + " " + extra_defines
 
-cxxflags = ("-g -c -Os -std=c++14 -fno-rtti -fno-exceptions " +
-           "-ffunction-sections -fdata-sections -mthumb " +
-           "-mcpu=cortex-m4 -mfloat-abi=hard " +
-           "-mfpu=fpv4-sp-d16 -fsingle-precision-constant " +
-           "-DF_CPU=80000000L -DPART_TM4C123GH6PM " +
-           get_includes())
+def get_cflags():
+    return ("-g -c -Os -ffunction-sections -fdata-sections " +
+            port["cflags"] + " " + get_defines() + " " + get_includes())
 
-lflags = ("-g -Os -nostartfiles -Wl,--gc-sections " +
-         "-T tm4c123gh6pm.ld -Wl,--entry=ResetISR -mthumb " +
-         "-mcpu=cortex-m4 -mfloat-abi=hard -mfpu=fpv4-sp-d16 " +
-         "-fsingle-precision-constant -lm -lstdc++ -lc")
+def get_cxxflags():
+    return ("-g -c -Os -std=c++14 -fno-rtti -fno-exceptions " +
+            "-ffunction-sections -fdata-sections " +
+            port["cflags"] + " " + get_defines() + " " + get_includes())
+
+def get_lflags():
+    lflags = "-g -Os -Wl,--gc-sections "
+    if board["ldscript"]:
+        lflags += "-T " + board["ldscript"] + " "
+    return lflags + port["lflags"]
 
 def write_buildfile():
     with open("build.ninja", "w") as buildfile:
         n = Writer(buildfile)
+        prefix = port["prefix"]
 
         # Variable declarations
         n.variable("lib_path", "/usr/arm-none-eabi/lib")
-        n.variable("cflags", cflags)
-        n.variable("cxxflags", cxxflags)
-        n.variable("lflags", lflags)
+        n.variable("cflags", get_cflags())
+        n.variable("cxxflags", get_cxxflags())
+        n.variable("lflags", get_lflags())
 
         # Rule declarations
         n.rule("cxx",
-               command = "arm-none-eabi-g++ $cxxflags -c $in -o $out")
+               command = prefix + "g++ $cxxflags -c $in -o $out")
 
         n.rule("cc",
-               command = "arm-none-eabi-gcc $cflags -c $in -o $out")
+               command = prefix + "gcc $cflags -c $in -o $out")
 
         n.rule("cl",
-               command = "arm-none-eabi-gcc $lflags $in -o $out")
+               command = prefix + "gcc $in $lflags -o $out")
 
         n.rule("oc",
-               command = "arm-none-eabi-objcopy -O binary $in $out")
+               command = prefix + "objcopy -O binary $in $out")
 
         n.rule("cdb",
               command = "ninja -t compdb cc cxx > compile_commands.json")
@@ -97,13 +154,34 @@ def write_buildfile():
             n.build(oname, "cl", ofiles)
 
         sources = get_sources()
-        map(cc, filter(lambda x : x.endswith(".c") or x.endswith(".S"), sources))
-        map(cxx, filter(lambda x : x.endswith(".cpp"), sources))
+        for s in filter(lambda x : x.endswith(".c") or x.endswith(".S"), sources):
+            cc(s)
+        for s in filter(lambda x : x.endswith(".cpp"), sources):
+            cxx(s)
 
         cl("main.elf", objects)
 
-        n.build("main.bin", "oc", "main.elf")
+        if port["asm"]:
+            n.build("main.bin", "oc", "main.elf")
 
 if __name__ == "__main__":
-    write_buildfile()
+    parser = argparse.ArgumentParser(description = "Generate build.ninja")
+    parser.add_argument("--board", choices = sorted(boards.keys()),
+                        default = "tm4c123",
+                        help = "target board (default: tm4c123)")
+    parser.add_argument("--app", default = "main.c",
+                        help = "source file providing main() (default: main.c)")
+    parser.add_argument("--define", action = "append", default = [],
+                        metavar = "NAME[=VALUE]",
+                        help = "extra preprocessor definition, e.g. " +
+                               "MAX_THREADS=1024; may be repeated")
+    args = parser.parse_args()
+
+    board = boards[args.board]
+    port = ports[board["port"]]
+    app = args.app
+    extra_defines = " ".join(map(lambda x : "-D"+x, args.define))
+    source_dirs = (common_source_dirs + port["source_dirs"] +
+                   board["source_dirs"])
 
+    write_buildfile()
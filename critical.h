@@ -0,0 +1,70 @@
+/*
+ * critical.h
+ *
+ * Short critical sections that need no system call.
+ *
+ * preempt_disable() and preempt_enable() keep the calling thread on the CPU
+ * between them. Ticks and interrupts are still handled and threads still
+ * wake up, but no other thread runs until the outermost preempt_enable(),
+ * which makes any switch that came due in the meantime:
+ *
+ *     preempt_disable();
+ *     queue->head = next;
+ *     queue->count--;
+ *     preempt_enable();
+ *
+ * They nest, and cost a few instructions: the nesting depth is a field of
+ * the calling thread, which the scheduler checks before it switches threads.
+ * They protect data shared between threads, not with ISRs. The thread must
+ * not block or sleep in between, and CPU budgets (see sys_set_budget()) are
+ * not enforced until it is done.
+ *
+ * critical_enter() and critical_exit() mask the interrupts whose ISRs call
+ * into the kernel, and the kernel's own, for data shared with ISRs:
+ *
+ *     irqstate_t state = critical_enter();
+ *     ...
+ *     critical_exit(state);
+ *
+ * On Cortex-M that is a BASEPRI write each way (see port_irq_mask()), and
+ * exceptions of higher priority than the kernel are not held up. They nest
+ * too, since critical_exit() puts back the mask that critical_enter() found.
+ * No system calls in between: SVCall is masked along with the rest.
+ */
+
+#ifndef CRITICAL_H_
+#define CRITICAL_H_
+
+#include "kernel.h"
+#include "port.h"
+#include "thread.h"
+
+#include <stdint.h>
+
+// Interrupt mask saved by critical_enter()
+typedef uint32_t irqstate_t;
+
+static inline void preempt_disable(void)
+{
+    thread_current->preempt_count++;
+    asm volatile("" : : : "memory");
+}
+
+static inline void preempt_enable(void)
+{
+    asm volatile("" : : : "memory");
+    if(--thread_current->preempt_count == 0 && kernel_need_resched)
+        port_preempt();
+}
+
+static inline irqstate_t critical_enter(void)
+{
+    return port_irq_mask();
+}
+
+static inline void critical_exit(irqstate_t state)
+{
+    port_irq_restore(state);
+}
+
+#endif /* CRITICAL_H_ */
@@ -6,6 +6,11 @@
  */
 
 #include "driver_serial.h"
+#include "kernel.h"
+#include "port.h"
+#include "syscalls.h"
+#include "thread.h"
+#include "trace.h"
 
 #include "driverlib/gpio.h"
 #include "driverlib/interrupt.h"
@@ -14,6 +19,7 @@
 #include "driverlib/rom_map.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/uart.h"
+#include "driverlib/udma.h"
 #include "inc/hw_gpio.h"
 #include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
@@ -23,12 +29,79 @@
 #include <stdint.h>
 #include <string.h>
 
-//#define RECEIVE_BUFFER_SIZE (64)
-//
-//char RXBuffer[RECEIVE_BUFFER_SIZE];
-//int16_t RXBuffer_head, RXBuffer_tail;
-//
-//void Serial_ISR();
+#define SERIAL_TX_MASK (SERIAL_TX_BUFFER_SIZE - 1)
+
+#if (SERIAL_TX_BUFFER_SIZE & SERIAL_TX_MASK) != 0
+#error "SERIAL_TX_BUFFER_SIZE must be a power of two"
+#endif
+
+/*
+ * Transmit ring. head and tail count bytes written and sent; they are only
+ * reduced modulo the buffer size when indexing. head is only written by the
+ * writing thread, tail only by the TX interrupt, or by a writer while the TX
+ * interrupt is masked.
+ */
+typedef struct
+{
+	uint8_t buf[SERIAL_TX_BUFFER_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	// Signalled by the ISR when it frees space and a writer is waiting
+	event_t space;
+	volatile bool waiting;
+} Serial_tx_t;
+
+static Serial_tx_t tx_rings[8];
+
+// Largest transfer a single uDMA channel structure can describe
+#define SERIAL_DMA_MAX_CHUNK (1024)
+
+/*
+ * uDMA transmit queue. head is the transfer being sent; inflight is the
+ * number of its bytes programmed into the channel, 0 when the channel is
+ * idle. Only touched by the ISR, or by a writer with the UART's interrupt
+ * masked in the NVIC.
+ */
+typedef struct
+{
+	Serial_xfer_t* head;
+	Serial_xfer_t* tail;
+	uint32_t inflight;
+	// Signalled by the ISR whenever a transfer completes
+	event_t done;
+} Serial_dma_t;
+
+static Serial_dma_t dma_queues[8];
+
+/*
+ * uDMA channel control table. Only the primary structures are used, so the
+ * alternate half is left out; the base must still be 1024-byte aligned.
+ */
+static tDMAControlTable dma_table[32] __attribute__((aligned(1024)));
+
+#define SERIAL_RX_MASK (SERIAL_RX_BUFFER_SIZE - 1)
+
+#if (SERIAL_RX_BUFFER_SIZE & SERIAL_RX_MASK) != 0
+#error "SERIAL_RX_BUFFER_SIZE must be a power of two"
+#endif
+
+/*
+ * Receive ring, the mirror image of the transmit ring: head is only written
+ * by the RX interrupt, tail only by the reading thread. Bytes that arrive
+ * while the ring is full are dropped and counted.
+ */
+typedef struct
+{
+	uint8_t buf[SERIAL_RX_BUFFER_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t dropped;
+	// Signalled by the ISR when it adds bytes and a reader is waiting
+	event_t data;
+	volatile bool waiting;
+} Serial_rx_t;
+
+static Serial_rx_t rx_rings[8];
 
 const uint32_t uart_bases[8] =
 {
@@ -42,6 +115,31 @@ const uint32_t uart_bases[8] =
     UART7_BASE,
 };
 
+const uint32_t uart_ints[8] =
+{
+    INT_UART0,
+    INT_UART1,
+    INT_UART2,
+    INT_UART3,
+    INT_UART4,
+    INT_UART5,
+    INT_UART6,
+    INT_UART7,
+};
+
+// uDMA TX channel and encoding for each UART (TM4C123 channel map)
+const uint32_t uart_dma_tx[8] =
+{
+    UDMA_CH9_UART0TX,
+    UDMA_CH23_UART1TX,
+    UDMA_CH13_UART2TX,
+    UDMA_CH17_UART3TX,
+    UDMA_CH19_UART4TX,
+    UDMA_CH7_UART5TX,
+    UDMA_CH11_UART6TX,
+    UDMA_CH21_UART7TX,
+};
+
 const uint32_t uart_peripherals[8] =
 {
     SYSCTL_PERIPH_UART0,
@@ -98,9 +196,25 @@ const uint32_t uart_gpio_pins[8] =
     GPIO_PIN_0 | GPIO_PIN_1,
 };
 
+/*
+ * Turns on the uDMA controller, the first time a UART is initialized.
+ */
+static void Serial_dma_init(void)
+{
+	static bool ready;
+
+	if (ready)
+		return;
+
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	uDMAEnable();
+	uDMAControlBaseSet(dma_table);
+	ready = true;
+}
+
 void Serial_init(Serial_module_e module, uint32_t baud)
 {
-//	RXBuffer_head = RXBuffer_tail = 0;
+	uint32_t ch = uart_dma_tx[module] & 0xFF;
 
 	SysCtlPeripheralEnable(uart_peripherals[module]);
 	SysCtlPeripheralEnable(gpio_peripherals[module]);
@@ -112,64 +226,448 @@ void Serial_init(Serial_module_e module, uint32_t baud)
 
 	UARTIntDisable(uart_bases[module], 0xFFFFFFFF);
 
-//	UARTFIFOLevelSet(UART0_BASE, UART_FIFO_TX1_8, UART_FIFO_RX1_8);
-//	UARTIntRegister(UART0_BASE, Serial_ISR);
-//	UARTIntEnable(UART0_BASE, UART_INT_RX | UART_INT_RT);
-//	IntEnable(INT_UART0);
+	tx_rings[module].head = tx_rings[module].tail = 0;
+	tx_rings[module].waiting = false;
+	rx_rings[module].head = rx_rings[module].tail = 0;
+	rx_rings[module].dropped = 0;
+	rx_rings[module].waiting = false;
+
+	// The TX channel moves one byte at a time from memory to the data
+	// register, in bursts of 4 whenever the FIFO is below its trigger level.
+	Serial_dma_init();
+	dma_queues[module].head = dma_queues[module].tail = NULL;
+	dma_queues[module].inflight = 0;
+	uDMAChannelAssign(uart_dma_tx[module]);
+	uDMAChannelAttributeDisable(ch, UDMA_ATTR_ALL);
+	uDMAChannelControlSet(ch | UDMA_PRI_SELECT,
+	UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+
+	// The TX interrupt fires when the FIFO drains to 2 bytes, leaving the
+	// ISR time to refill it before the line goes idle. The RX interrupt
+	// fires once the FIFO holds 8 bytes; the receive timeout (32 bit
+	// periods of silence) picks up the tail of a burst below that level.
+	UARTFIFOLevelSet(uart_bases[module], UART_FIFO_TX1_8, UART_FIFO_RX4_8);
+	UARTTxIntModeSet(uart_bases[module], UART_TXINT_MODE_FIFO);
+	UARTIntEnable(uart_bases[module], UART_INT_TX | UART_INT_RX | UART_INT_RT);
+	IntEnable(uart_ints[module]);
 
 	UARTEnable(uart_bases[module]);
 }
 
+/*
+ * Moves bytes from the ring into the TX FIFO until one or the other runs
+ * out. Called from the ISR, or with the UART's interrupt masked.
+ */
+static void Serial_tx_fill(uint32_t base, Serial_tx_t* tx)
+{
+	uint32_t tail = tx->tail;
+
+	while (tail != tx->head && UARTSpaceAvail(base))
+	{
+		UARTCharPutNonBlocking(base, tx->buf[tail & SERIAL_TX_MASK]);
+		tail++;
+	}
+
+	tx->tail = tail;
+}
+
+/*
+ * Starts transmission of newly queued bytes. The TX interrupt only fires
+ * when the FIFO level drops through the trigger level, so if the FIFO is
+ * already below it, nothing would pick the new bytes up without this. The
+ * whole UART interrupt is masked, not just TX, since the ISR refills the
+ * FIFO on RX and receive timeout interrupts too.
+ */
+static void Serial_tx_kick(Serial_module_e module)
+{
+	IntDisable(uart_ints[module]);
+	Serial_tx_fill(uart_bases[module], &tx_rings[module]);
+	IntEnable(uart_ints[module]);
+}
+
+/*
+ * Waits for the ISR to free space in the ring. Threads sleep on the space
+ * event; ISRs and code running before kernel_init() cannot block, so they
+ * keep the FIFO fed themselves until the ring moves.
+ */
+static void Serial_tx_wait(Serial_module_e module)
+{
+	Serial_tx_t* tx = &tx_rings[module];
+	uint32_t seen, tail = tx->tail;
+
+	if (thread_current == NULL || port_in_isr())
+	{
+		while (tx->tail == tail)
+			Serial_tx_kick(module);
+		return;
+	}
+
+	// Publish waiting before sampling the event, so that a signal from an
+	// ISR that frees space from here on makes sys_event_wait() return at once.
+	tx->waiting = true;
+	seen = tx->space;
+	if (tx->tail == tail)
+		sys_event_wait(&tx->space, seen, EVENT_WAIT_FOREVER);
+}
+
+/*
+ * Programs the channel with the next chunk of the transfer at the head of
+ * the queue. Called from the ISR, or with the UART's interrupt masked.
+ */
+static void Serial_dma_start(Serial_module_e module)
+{
+	Serial_dma_t* dma = &dma_queues[module];
+	Serial_xfer_t* xfer = dma->head;
+	uint32_t ch = uart_dma_tx[module] & 0xFF;
+	uint32_t n = xfer->len - xfer->sent;
+
+	if (n > SERIAL_DMA_MAX_CHUNK)
+		n = SERIAL_DMA_MAX_CHUNK;
+
+	uDMAChannelTransferSet(ch | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+	(void*) (xfer->buf + xfer->sent),
+	(void*) (uart_bases[module] + UART_O_DR), n);
+	dma->inflight = n;
+	uDMAChannelEnable(ch);
+}
+
+/*
+ * Retires the chunk in flight if the channel has finished it (a basic mode
+ * channel disables itself when done), and starts the next one. Transfers
+ * longer than one channel structure, and transfers queued behind each other,
+ * are chained from here. When the queue empties, the TX ring takes the UART
+ * back.
+ */
+static void Serial_dma_complete(Serial_module_e module)
+{
+	Serial_dma_t* dma = &dma_queues[module];
+	Serial_xfer_t* xfer = dma->head;
+	uint32_t base = uart_bases[module];
+	uint32_t ch = uart_dma_tx[module] & 0xFF;
+
+	if (!dma->inflight || uDMAChannelIsEnabled(ch))
+		return;
+
+	uDMAIntClear(1 << ch);
+	xfer->sent += dma->inflight;
+	dma->inflight = 0;
+
+	if (xfer->sent == xfer->len)
+	{
+		// The owner may reuse xfer as soon as done is set
+		dma->head = xfer->next;
+		xfer->done = true;
+		kernel_event_signal(&dma->done);
+	}
+
+	if (dma->head)
+	{
+		Serial_dma_start(module);
+	}
+	else
+	{
+		UARTDMADisable(base, UART_DMA_TX);
+		UARTIntEnable(base, UART_INT_TX);
+	}
+}
+
+/*
+ * Waits for xfer to complete, or for the whole uDMA queue to drain if xfer
+ * is NULL. As with the ring, contexts that cannot block poll the channel
+ * themselves, since the UART interrupt may not be able to preempt them.
+ */
+static void Serial_dma_wait(Serial_module_e module, const Serial_xfer_t* xfer)
+{
+	Serial_dma_t* dma = &dma_queues[module];
+	uint32_t seen;
+
+	while (xfer ? !xfer->done : (dma->head != NULL))
+	{
+		if (thread_current == NULL || port_in_isr())
+		{
+			IntDisable(uart_ints[module]);
+			Serial_dma_complete(module);
+			IntEnable(uart_ints[module]);
+			continue;
+		}
+
+		seen = dma->done;
+		if (xfer ? !xfer->done : (dma->head != NULL))
+			sys_event_wait(&dma->done, seen, EVENT_WAIT_FOREVER);
+	}
+}
+
+/*
+ * Waits for everything in the TX ring to reach the FIFO.
+ */
+static void Serial_tx_drain(Serial_module_e module)
+{
+	Serial_tx_t* tx = &tx_rings[module];
+
+	while (tx->tail != tx->head)
+		Serial_tx_wait(module);
+}
+
 void Serial_putc(Serial_module_e module, char c)
 {
-	UARTCharPut(uart_bases[module], c);
+	Serial_writebuf(module, (const uint8_t*) &c, 1);
+}
+
+/*
+ * Empties the RX FIFO into the ring and wakes a waiting reader. Called from
+ * the ISR, or with the UART's interrupt masked.
+ */
+static void Serial_rx_fill(uint32_t base, Serial_rx_t* rx)
+{
+	uint32_t head = rx->head, start = head;
+	uint8_t c;
+
+	while (UARTCharsAvail(base))
+	{
+		c = (uint8_t) UARTCharGetNonBlocking(base);
+
+		if ((head - rx->tail) < SERIAL_RX_BUFFER_SIZE)
+			rx->buf[head++ & SERIAL_RX_MASK] = c;
+		else
+			rx->dropped++;
+	}
+
+	rx->head = head;
+
+	if (head != start && rx->waiting)
+	{
+		rx->waiting = false;
+		kernel_event_signal(&rx->data);
+	}
 }
 
 bool Serial_avail(Serial_module_e module)
 {
-	return UARTCharsAvail(uart_bases[module]);
+	return rx_rings[module].head != rx_rings[module].tail;
 }
 
 int Serial_getc(Serial_module_e module)
 {
-	if (!UARTCharsAvail(uart_bases[module]))
+	Serial_rx_t* rx = &rx_rings[module];
+	int c;
+
+	if (rx->head == rx->tail)
 		return -1;
-	return (int) UARTCharGet(uart_bases[module]);
+
+	c = rx->buf[rx->tail & SERIAL_RX_MASK];
+	rx->tail++;
+	return c;
 }
 
-void Serial_puts(Serial_module_e module, const char * s)
+/**
+ * @brief Reads up to len bytes, blocking the calling thread until at least
+ * one has arrived or timeout_ms milliseconds have passed. Called from an ISR
+ * or before kernel_init(), it never blocks.
+ *
+ * @param timeout_ms How long to wait for the first byte; EVENT_WAIT_FOREVER
+ *                   waits indefinitely, 0 not at all.
+ * @return The number of bytes read, 0 on timeout.
+ */
+uint32_t Serial_read(Serial_module_e module, uint8_t* buf, uint32_t len,
+		uint32_t timeout_ms)
 {
-	uint16_t i;
-	for (i = 0; i < strlen(s); i++)
+	Serial_rx_t* rx = &rx_rings[module];
+	uint32_t n, seen, tail, start, elapsed, wait_ms = timeout_ms;
+
+	if (!len)
+		return 0;
+
+	if (thread_current == NULL || port_in_isr())
 	{
-		if (s[i] == 0)
-			break;
-		UARTCharPut(uart_bases[module], s[i]);
+		// The RX interrupt may not be able to preempt the caller
+		IntDisable(uart_ints[module]);
+		Serial_rx_fill(uart_bases[module], rx);
+		IntEnable(uart_ints[module]);
 	}
+	else
+	{
+		// As for the TX ring: publish waiting before sampling the event.
+		// A wakeup can leave the ring empty, so each wait only gets what
+		// is left of timeout_ms.
+		start = sys_time();
+		while (rx->head == rx->tail)
+		{
+			if (timeout_ms != EVENT_WAIT_FOREVER)
+			{
+				elapsed = sys_time() - start;
+				wait_ms = elapsed < timeout_ms ? timeout_ms - elapsed : 0;
+			}
+
+			rx->waiting = true;
+			seen = rx->data;
+			if (rx->head == rx->tail &&
+				!sys_event_wait(&rx->data, seen, wait_ms))
+				return 0;
+		}
+	}
+
+	tail = rx->tail;
+	for (n = 0; n < len && tail != rx->head; n++)
+		buf[n] = rx->buf[tail++ & SERIAL_RX_MASK];
+
+	// The bytes must be copied out before the ISR may overwrite them
+	asm volatile("" : : : "memory");
+	rx->tail = tail;
+
+	return n;
+}
+
+/**
+ * @brief Returns the number of received bytes dropped because the RX ring
+ * was full.
+ */
+uint32_t Serial_rx_dropped(Serial_module_e module)
+{
+	return rx_rings[module].dropped;
+}
+
+void Serial_puts(Serial_module_e module, const char * s)
+{
+	Serial_writebuf(module, (const uint8_t*) s, strlen(s));
 }
 
 void Serial_writebuf(Serial_module_e module, const uint8_t* buf, uint32_t len)
 {
-	uint32_t i;
-	for (i = 0; i < len; i++)
+	Serial_tx_t* tx = &tx_rings[module];
+	uint32_t head;
+
+	// Large writes go out by uDMA, without being copied
+	if (SERIAL_DMA_MIN && len >= SERIAL_DMA_MIN)
 	{
-		UARTCharPut(uart_bases[module], buf[i]);
+		Serial_xfer_t xfer;
+
+		Serial_write_async(module, buf, len, &xfer);
+		Serial_xfer_wait(&xfer);
+		return;
+	}
+
+	// Anything already queued for the uDMA goes first
+	Serial_dma_wait(module, NULL);
+
+	head = tx->head;
+	while (len)
+	{
+		while (len && (head - tx->tail) < SERIAL_TX_BUFFER_SIZE)
+		{
+			tx->buf[head & SERIAL_TX_MASK] = *buf++;
+			head++;
+			len--;
+		}
+
+		// The bytes must be in the ring before the ISR can see them
+		asm volatile("" : : : "memory");
+		tx->head = head;
+
+		Serial_tx_kick(module);
+
+		if (len)
+			Serial_tx_wait(module);
 	}
 }
 
+/**
+ * @brief Queues buf to be sent by the uDMA and returns without waiting. The
+ * CPU is not involved until the transfer completes, apart from one interrupt
+ * per SERIAL_DMA_MAX_CHUNK bytes. Transfers are sent in the order they are
+ * queued, after anything already written through the TX ring.
+ *
+ * @param xfer Completion handle, filled in here. Neither it nor buf may be
+ *             reused until Serial_xfer_done() returns true.
+ */
+void Serial_write_async(Serial_module_e module, const uint8_t* buf,
+		uint32_t len, Serial_xfer_t* xfer)
+{
+	Serial_dma_t* dma = &dma_queues[module];
+	uint32_t base = uart_bases[module];
+
+	xfer->buf = buf;
+	xfer->len = len;
+	xfer->sent = 0;
+	xfer->module = module;
+	xfer->next = NULL;
+	xfer->done = (len == 0);
+
+	if (!len)
+		return;
+
+	Serial_tx_drain(module);
+
+	IntDisable(uart_ints[module]);
+
+	if (dma->head)
+		dma->tail->next = xfer;
+	else
+		dma->head = xfer;
+	dma->tail = xfer;
+
+	if (!dma->inflight)
+	{
+		// The ring is empty and stays that way until the queue drains, so
+		// its interrupt is only overhead in the meantime
+		UARTIntDisable(base, UART_INT_TX);
+		UARTDMAEnable(base, UART_DMA_TX);
+		Serial_dma_start(module);
+	}
+
+	IntEnable(uart_ints[module]);
+}
+
+bool Serial_xfer_done(const Serial_xfer_t* xfer)
+{
+	return xfer->done;
+}
+
+/**
+ * @brief Blocks the calling thread until xfer has been sent.
+ */
+void Serial_xfer_wait(Serial_xfer_t* xfer)
+{
+	Serial_dma_wait(xfer->module, xfer);
+}
+
 void Serial_flush(Serial_module_e module)
 {
+	Serial_dma_wait(module, NULL);
+	Serial_tx_drain(module);
+
 	while (UARTBusy(uart_bases[module]))
 		;
 }
 
-//uint8_t Serial_available()
-//{
-//	return((RXBuffer_head >= RXBuffer_tail) ?
-//			(RXBuffer_head - RXBuffer_tail) : RECEIVE_BUFFER_SIZE - (RXBuffer_tail - RXBuffer_head));
-//}
-//
-//void Serial_ISR()
-//{
-//
-//}
+/*
+ * UART interrupt, which the uDMA also raises when the TX channel finishes:
+ * drain the RX FIFO into the RX ring, chain the next uDMA chunk, refill the
+ * TX FIFO from the TX ring, and wake any thread waiting on either ring.
+ */
+static void Serial_ISR(Serial_module_e module)
+{
+	uint32_t base = uart_bases[module];
+	Serial_tx_t* tx = &tx_rings[module];
+
+	trace_isr(uart_ints[module]);
+
+	UARTIntClear(base, UARTIntStatus(base, true));
+	Serial_rx_fill(base, &rx_rings[module]);
+	Serial_dma_complete(module);
+	Serial_tx_fill(base, tx);
+
+	if (tx->waiting)
+	{
+		tx->waiting = false;
+		kernel_event_signal(&tx->space);
+	}
+}
+
+void Serial_ISR0(void) { Serial_ISR(Serial_module_0); }
+void Serial_ISR1(void) { Serial_ISR(Serial_module_1); }
+void Serial_ISR2(void) { Serial_ISR(Serial_module_2); }
+void Serial_ISR3(void) { Serial_ISR(Serial_module_3); }
+void Serial_ISR4(void) { Serial_ISR(Serial_module_4); }
+void Serial_ISR5(void) { Serial_ISR(Serial_module_5); }
+void Serial_ISR6(void) { Serial_ISR(Serial_module_6); }
+void Serial_ISR7(void) { Serial_ISR(Serial_module_7); }
@@ -24,6 +24,49 @@ typedef enum
 } Serial_module_e;
 
 #define Serial_module_debug (Serial_module_0)
+
+/*
+ * Size of each module's transmit ring, in bytes. Must be a power of two.
+ * Writes are copied into the ring and sent by the UART interrupt; a thread
+ * only blocks when the ring is full. Concurrent writers to one module must
+ * be serialized by the caller (e.g. with a lock_t).
+ */
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE (128)
+#endif
+
+/*
+ * Size of each module's receive ring, in bytes. Must be a power of two. The
+ * UART interrupt moves received bytes into it; Serial_getc() and
+ * Serial_read() take them out.
+ */
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE (128)
+#endif
+
+/*
+ * Writes of at least this many bytes bypass the transmit ring and are sent by
+ * the uDMA straight out of the caller's buffer. 0 disables the uDMA path.
+ */
+#ifndef SERIAL_DMA_MIN
+#define SERIAL_DMA_MIN (64)
+#endif
+
+/*
+ * Completion handle for Serial_write_async(). The handle and the buffer must
+ * stay valid until the transfer is done.
+ */
+typedef struct Serial_xfer
+{
+    const uint8_t* buf;
+    uint32_t len;
+    // Bytes the uDMA has finished sending
+    uint32_t sent;
+    volatile bool done;
+    Serial_module_e module;
+    struct Serial_xfer* next;
+} Serial_xfer_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -34,7 +77,14 @@ int Serial_getc(Serial_module_e module);
 void Serial_puts(Serial_module_e module, const char * s);
 void Serial_writebuf(Serial_module_e module, const uint8_t* buf, uint32_t len);
 void Serial_flush(Serial_module_e module);
+void Serial_write_async(Serial_module_e module, const uint8_t* buf,
+                        uint32_t len, Serial_xfer_t* xfer);
+bool Serial_xfer_done(const Serial_xfer_t* xfer);
+void Serial_xfer_wait(Serial_xfer_t* xfer);
 bool Serial_avail(Serial_module_e module);
+uint32_t Serial_read(Serial_module_e module, uint8_t* buf, uint32_t len,
+                     uint32_t timeout_ms);
+uint32_t Serial_rx_dropped(Serial_module_e module);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,533 @@
+/**
+ * @brief Two-level segregated fit heap; see heap.h.
+ *
+ * Every block starts with a header holding the address of the block before
+ * it in memory and its payload size. A free block also holds its free list
+ * links, in what would otherwise be its payload. Block sizes are multiples
+ * of HEAP_ALIGN, as are the headers, so every payload is HEAP_ALIGN-aligned.
+ * The heap ends with a zero-size block that is never free, so the last real
+ * block needs no special case when looking for a free neighbour.
+ */
+
+#include "heap.h"
+#include "port.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HEAP_ALIGN (8)
+// log2 of the number of second-level classes per power of two
+#define HEAP_SL_LOG2 (4)
+#define HEAP_SL_COUNT (1 << HEAP_SL_LOG2)
+// Below HEAP_SMALL, all sizes are in first level 0, in HEAP_ALIGN steps
+#define HEAP_FL_SHIFT (HEAP_SL_LOG2 + 3)
+#define HEAP_SMALL ((size_t) 1 << HEAP_FL_SHIFT)
+#define HEAP_FL_COUNT (HEAP_FL_MAX_LOG2 - HEAP_FL_SHIFT + 1)
+
+typedef struct heap_block
+{
+    // The block before this one in memory, or NULL for the first
+    struct heap_block* prev_phys;
+    // Payload size, or'd with HEAP_BLOCK_FREE if the block is free
+    size_t size;
+    // Free list links; free blocks only
+    struct heap_block* next_free;
+    struct heap_block* prev_free;
+} heap_block_t;
+
+#define HEAP_BLOCK_FREE ((size_t) 1)
+#define HEAP_HEADER (offsetof(heap_block_t, next_free))
+// Smallest payload: room for the free list links
+#define HEAP_BLOCK_MIN (sizeof(heap_block_t) - HEAP_HEADER)
+// Largest payload that fits in the last first-level class
+#define HEAP_BLOCK_MAX (((size_t) 1 << HEAP_FL_MAX_LOG2) - HEAP_ALIGN)
+
+static uint32_t heap_fl_bitmap;
+static uint32_t heap_sl_bitmap[HEAP_FL_COUNT];
+static heap_block_t* heap_lists[HEAP_FL_COUNT][HEAP_SL_COUNT];
+static bool heap_ready;
+
+// size, free and the counters; used and the rest are filled in by
+// heap_do_stats()
+static heap_stats_t heap_counters;
+
+static inline size_t heap_block_size(const heap_block_t* b)
+{
+    return b->size & ~HEAP_BLOCK_FREE;
+}
+
+static inline void* heap_payload(heap_block_t* b)
+{
+    return (uint8_t*) b + HEAP_HEADER;
+}
+
+static inline heap_block_t* heap_block(void* ptr)
+{
+    return (heap_block_t*)((uint8_t*) ptr - HEAP_HEADER);
+}
+
+static inline heap_block_t* heap_next(heap_block_t* b)
+{
+    return (heap_block_t*)((uint8_t*) heap_payload(b) + heap_block_size(b));
+}
+
+// Index of the most significant set bit; x must not be 0
+static inline uint32_t heap_fls(size_t x)
+{
+    return sizeof(unsigned long) * 8 - 1 - __builtin_clzl(x);
+}
+
+/*
+ * Finds the free list for blocks of a size.
+ */
+static void heap_mapping(size_t size, uint32_t* fl, uint32_t* sl)
+{
+    uint32_t f;
+
+    if(size < HEAP_SMALL)
+    {
+        *fl = 0;
+        *sl = size / (HEAP_SMALL / HEAP_SL_COUNT);
+    }
+    else
+    {
+        f = heap_fls(size);
+        *sl = (size >> (f - HEAP_SL_LOG2)) ^ HEAP_SL_COUNT;
+        *fl = f - HEAP_FL_SHIFT + 1;
+    }
+}
+
+static void heap_insert(heap_block_t* b)
+{
+    uint32_t fl, sl;
+
+    heap_mapping(b->size, &fl, &sl);
+
+    b->prev_free = NULL;
+    b->next_free = heap_lists[fl][sl];
+    if(b->next_free)
+        b->next_free->prev_free = b;
+    heap_lists[fl][sl] = b;
+
+    heap_fl_bitmap |= 1u << fl;
+    heap_sl_bitmap[fl] |= 1u << sl;
+
+    heap_counters.free += HEAP_HEADER + b->size;
+    b->size |= HEAP_BLOCK_FREE;
+}
+
+static void heap_remove(heap_block_t* b)
+{
+    uint32_t fl, sl;
+
+    b->size &= ~HEAP_BLOCK_FREE;
+    heap_counters.free -= HEAP_HEADER + b->size;
+
+    heap_mapping(b->size, &fl, &sl);
+
+    if(b->next_free)
+        b->next_free->prev_free = b->prev_free;
+    if(b->prev_free)
+        b->prev_free->next_free = b->next_free;
+    else
+    {
+        heap_lists[fl][sl] = b->next_free;
+        if(!b->next_free)
+        {
+            heap_sl_bitmap[fl] &= ~(1u << sl);
+            if(!heap_sl_bitmap[fl])
+                heap_fl_bitmap &= ~(1u << fl);
+        }
+    }
+}
+
+/*
+ * Takes a free block of at least size bytes off its free list. The size is
+ * rounded up to the next class boundary first, so that any block in the
+ * class found is big enough and no list has to be searched.
+ */
+static heap_block_t* heap_take(size_t size)
+{
+    heap_block_t* b;
+    uint32_t fl, sl, map;
+
+    if(size >= HEAP_SMALL)
+        size += ((size_t) 1 << (heap_fls(size) - HEAP_SL_LOG2)) - 1;
+    heap_mapping(size, &fl, &sl);
+    if(fl >= HEAP_FL_COUNT)
+        return NULL;
+
+    map = heap_sl_bitmap[fl] & (~0u << sl);
+    if(!map)
+    {
+        map = heap_fl_bitmap & (~0u << (fl + 1));
+        if(!map)
+            return NULL;
+        fl = __builtin_ctz(map);
+        map = heap_sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(map);
+
+    b = heap_lists[fl][sl];
+    heap_remove(b);
+    return b;
+}
+
+/*
+ * Merges next, which must follow b in memory, into b. Neither may be on a
+ * free list.
+ */
+static void heap_absorb(heap_block_t* b, heap_block_t* next)
+{
+    b->size += HEAP_HEADER + next->size;
+    heap_next(b)->prev_phys = b;
+}
+
+/*
+ * Cuts b, which must not be on a free list, down to size bytes, and frees
+ * the rest if it is big enough to be a block of its own.
+ */
+static void heap_trim(heap_block_t* b, size_t size)
+{
+    heap_block_t *rest, *next;
+
+    if(b->size < size + sizeof(heap_block_t))
+        return;
+
+    rest = (heap_block_t*)((uint8_t*) heap_payload(b) + size);
+    rest->prev_phys = b;
+    rest->size = b->size - size - HEAP_HEADER;
+    b->size = size;
+
+    next = heap_next(rest);
+    next->prev_phys = rest;
+    if(next->size & HEAP_BLOCK_FREE)
+    {
+        heap_remove(next);
+        heap_absorb(rest, next);
+    }
+    heap_insert(rest);
+}
+
+/*
+ * Rounds a request up to a block size, or returns 0 if it is too big.
+ */
+static size_t heap_adjust(size_t size)
+{
+    if(size > HEAP_BLOCK_MAX)
+        return 0;
+    size = (size + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1);
+    return size < HEAP_BLOCK_MIN ? HEAP_BLOCK_MIN : size;
+}
+
+static void heap_account(void)
+{
+    uint32_t used = heap_counters.size - heap_counters.free;
+
+    if(used > heap_counters.peak)
+        heap_counters.peak = used;
+}
+
+/*
+ * Lays out the heap as one free block followed by the end marker, over a
+ * static array of HEAP_SIZE bytes. The boards' _sbrk() only grows towards
+ * the current stack pointer, and every stack lives in .bss, below where it
+ * starts, so it cannot supply the heap.
+ */
+static void heap_setup(void)
+{
+    static uint8_t heap_area[HEAP_SIZE] __attribute__((aligned(HEAP_ALIGN)));
+    uintptr_t start = (uintptr_t) heap_area, end;
+    size_t size;
+    heap_block_t *b, *last;
+
+    heap_ready = true;
+
+    end = (start + HEAP_SIZE) & ~(uintptr_t)(HEAP_ALIGN - 1);
+    start = (start + HEAP_ALIGN - 1) & ~(uintptr_t)(HEAP_ALIGN - 1);
+    if(end - start < 2 * HEAP_HEADER + HEAP_BLOCK_MIN)
+        return;
+
+    size = end - start - 2 * HEAP_HEADER;
+    if(size > HEAP_BLOCK_MAX)
+        size = HEAP_BLOCK_MAX;
+
+    b = (heap_block_t*) start;
+    b->prev_phys = NULL;
+    b->size = size;
+
+    last = heap_next(b);
+    last->prev_phys = b;
+    last->size = 0;
+
+    heap_counters.size = HEAP_HEADER + size;
+    heap_insert(b);
+}
+
+static void* heap_do_alloc(size_t size)
+{
+    heap_block_t* b = NULL;
+
+    size = heap_adjust(size);
+    if(size)
+        b = heap_take(size);
+    if(!b)
+    {
+        heap_counters.failures++;
+        return NULL;
+    }
+
+    heap_trim(b, size);
+    heap_counters.allocs++;
+    heap_account();
+    return heap_payload(b);
+}
+
+static void heap_do_free(void* ptr)
+{
+    heap_block_t* b = heap_block(ptr);
+    heap_block_t* other;
+
+    other = b->prev_phys;
+    if(other && (other->size & HEAP_BLOCK_FREE))
+    {
+        heap_remove(other);
+        heap_absorb(other, b);
+        b = other;
+    }
+
+    other = heap_next(b);
+    if(other->size & HEAP_BLOCK_FREE)
+    {
+        heap_remove(other);
+        heap_absorb(b, other);
+    }
+
+    heap_insert(b);
+    heap_counters.frees++;
+}
+
+/*
+ * Resizes a block without moving it, taking space from the next block if
+ * that is free. Returns NULL if the block cannot grow enough in place.
+ */
+static void* heap_do_resize(void* ptr, size_t size)
+{
+    heap_block_t* b = heap_block(ptr);
+    heap_block_t* next = heap_next(b);
+
+    size = heap_adjust(size);
+    if(!size)
+        return NULL;
+
+    if(size > b->size)
+    {
+        if(!(next->size & HEAP_BLOCK_FREE) ||
+           b->size + HEAP_HEADER + heap_block_size(next) < size)
+            return NULL;
+        heap_remove(next);
+        heap_absorb(b, next);
+    }
+
+    heap_trim(b, size);
+    heap_account();
+    return ptr;
+}
+
+/*
+ * The largest free block is in the highest non-empty class, so only that
+ * free list is searched.
+ */
+static void heap_do_stats(heap_stats_t* stats)
+{
+    heap_block_t* b;
+    uint32_t fl, sl;
+    size_t largest = 0;
+
+    *stats = heap_counters;
+    stats->used = heap_counters.size - heap_counters.free;
+
+    if(heap_fl_bitmap)
+    {
+        fl = heap_fls(heap_fl_bitmap);
+        sl = heap_fls(heap_sl_bitmap[fl]);
+        for(b = heap_lists[fl][sl]; b; b = b->next_free)
+            if(heap_block_size(b) > largest)
+                largest = heap_block_size(b);
+    }
+
+    stats->largest_free = largest;
+    stats->fragmentation =
+        stats->free ? 100 - (uint32_t)((uint64_t)(HEAP_HEADER + largest) *
+                                       100 / stats->free)
+                    : 0;
+}
+
+/**
+ * @brief Performs a heap operation, for SYSCALL_HEAP, ISRs, and code that
+ * runs before kernel_init(). Sets the heap up on first use.
+ *
+ * @return The allocated or resized block for HEAP_OP_ALLOC and
+ * HEAP_OP_RESIZE, or NULL if there is no room.
+ */
+void* heap_kernel(uint32_t op, void* ptr, size_t size)
+{
+    if(!heap_ready)
+        heap_setup();
+
+    switch(op)
+    {
+    case HEAP_OP_ALLOC:
+        return heap_do_alloc(size);
+
+    case HEAP_OP_FREE:
+        if(ptr)
+            heap_do_free(ptr);
+        return NULL;
+
+    case HEAP_OP_RESIZE:
+        return heap_do_resize(ptr, size);
+
+    case HEAP_OP_STATS:
+        heap_do_stats((heap_stats_t*) ptr);
+        return ptr;
+    }
+
+    return NULL;
+}
+
+/*
+ * Threads go through the kernel; anything that already runs at the kernel's
+ * priority, or before there are threads, calls it directly.
+ */
+static void* heap_call(uint32_t op, void* ptr, size_t size)
+{
+    if(!thread_current || port_in_isr())
+        return heap_kernel(op, ptr, size);
+    return sys_heap(op, ptr, size);
+}
+
+/**
+ * @brief Allocates size bytes, 8-byte aligned.
+ *
+ * @return The block, or NULL if there is no free block big enough.
+ */
+void* heap_alloc(size_t size)
+{
+    return heap_call(HEAP_OP_ALLOC, NULL, size);
+}
+
+/**
+ * @brief Frees a block from heap_alloc() or heap_realloc(). ptr may be NULL.
+ */
+void heap_free(void* ptr)
+{
+    if(ptr)
+        heap_call(HEAP_OP_FREE, ptr, 0);
+}
+
+/**
+ * @brief Resizes a block, moving it if it cannot be resized in place. With
+ * a NULL ptr, allocates; with a size of 0, frees and returns NULL.
+ *
+ * @return The block, or NULL if there is no room, in which case ptr is left
+ * as it was.
+ */
+void* heap_realloc(void* ptr, size_t size)
+{
+    void* p;
+    size_t old;
+
+    if(!ptr)
+        return heap_alloc(size);
+    if(!size)
+    {
+        heap_free(ptr);
+        return NULL;
+    }
+
+    p = heap_call(HEAP_OP_RESIZE, ptr, size);
+    if(p)
+        return p;
+
+    p = heap_alloc(size);
+    if(p)
+    {
+        old = heap_block(ptr)->size;
+        memcpy(p, ptr, old < size ? old : size);
+        heap_free(ptr);
+    }
+    return p;
+}
+
+/**
+ * @brief Fills in a snapshot of the heap's usage.
+ */
+void heap_stats(heap_stats_t* stats)
+{
+    heap_call(HEAP_OP_STATS, stats, 0);
+}
+
+#if HEAP_MALLOC
+/*
+ * The C library's allocator entry points. newlib calls the reentrant
+ * versions internally (printf() buffers, for instance); defining them here
+ * keeps its own allocator out of the link altogether.
+ */
+struct _reent;
+
+void* malloc(size_t size)
+{
+    return heap_alloc(size);
+}
+
+void free(void* ptr)
+{
+    heap_free(ptr);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    return heap_realloc(ptr, size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    void* p;
+
+    if(__builtin_mul_overflow(n, size, &size))
+        return NULL;
+    p = heap_alloc(size);
+    if(p)
+        memset(p, 0, size);
+    return p;
+}
+
+void* _malloc_r(struct _reent* r, size_t size)
+{
+    (void) r;
+    return malloc(size);
+}
+
+void _free_r(struct _reent* r, void* ptr)
+{
+    (void) r;
+    free(ptr);
+}
+
+void* _realloc_r(struct _reent* r, void* ptr, size_t size)
+{
+    (void) r;
+    return realloc(ptr, size);
+}
+
+void* _calloc_r(struct _reent* r, size_t n, size_t size)
+{
+    (void) r;
+    return calloc(n, size);
+}
+#endif
@@ -0,0 +1,93 @@
+/*
+ * heap.h
+ *
+ * Variable-size allocation with a bounded worst case: a two-level segregated
+ * fit (TLSF) allocator. Free blocks are kept in size classes indexed by a
+ * first level, the power of two below the size, and a second level that
+ * splits each power of two into HEAP_SL_COUNT linear steps, with a bitmap at
+ * each level. Finding a free block big enough is two find-first-set
+ * operations, and a freed block is merged with its free neighbours in memory
+ * straight away, so heap_alloc() and heap_free() take a bounded number of
+ * steps whatever the number and layout of blocks.
+ *
+ * The heap belongs to the kernel. Threads call heap_alloc(), heap_free() and
+ * heap_realloc(), which are system calls; ISRs, which run at the kernel's
+ * priority, and code that runs before kernel_init() use the heap directly.
+ * On the boards malloc(), free(), realloc() and calloc(), and newlib's
+ * reentrant _malloc_r() family, are routed to the heap (see HEAP_MALLOC), so
+ * printf() and friends share it and are safe to call from any thread.
+ *
+ * heap_realloc() grows or shrinks a block in place when it can. Otherwise it
+ * allocates a new block and copies in the calling thread, so the copy does
+ * not hold up the kernel.
+ */
+
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of the static array the heap is laid out over on first use
+#ifndef HEAP_SIZE
+#ifdef PORT_HOST
+#define HEAP_SIZE (1024 * 1024)
+#else
+#define HEAP_SIZE (8 * 1024)
+#endif
+#endif
+
+// log2 of the block size limit. Each power of two up to it costs 16 free
+// list heads.
+#ifndef HEAP_FL_MAX_LOG2
+#ifdef PORT_HOST
+#define HEAP_FL_MAX_LOG2 (24)
+#else
+#define HEAP_FL_MAX_LOG2 (16)
+#endif
+#endif
+
+// Route malloc() and newlib's allocator entry points to the heap. On the host
+// the C library's malloc() is left alone.
+#ifndef HEAP_MALLOC
+#ifdef PORT_HOST
+#define HEAP_MALLOC (0)
+#else
+#define HEAP_MALLOC (1)
+#endif
+#endif
+
+// Operations for SYSCALL_HEAP; see heap_kernel()
+#define HEAP_OP_ALLOC (0)
+#define HEAP_OP_FREE (1)
+#define HEAP_OP_RESIZE (2)
+#define HEAP_OP_STATS (3)
+
+// Heap usage. Sizes are in bytes and include the block headers.
+typedef struct
+{
+    uint32_t size;
+    uint32_t used;
+    // Most ever in use at once
+    uint32_t peak;
+    uint32_t free;
+    // Largest single free block, i.e. the largest allocation that would
+    // succeed now
+    uint32_t largest_free;
+    // Percentage of the free space that is not in the largest free block
+    uint32_t fragmentation;
+    uint32_t allocs;
+    uint32_t frees;
+    // Allocations that failed for lack of a big enough free block
+    uint32_t failures;
+} heap_stats_t;
+
+void* heap_alloc(size_t size);
+void heap_free(void* ptr);
+void* heap_realloc(void* ptr, size_t size);
+void heap_stats(heap_stats_t* stats);
+
+// Kernel and ISR side; see heap.c
+void* heap_kernel(uint32_t op, void* ptr, size_t size);
+
+#endif /* HEAP_H_ */
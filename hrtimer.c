@@ -0,0 +1,408 @@
+/**
+ * @brief High-resolution timer wheel; see hrtimer.h.
+ *
+ * Everything below the user API runs at the kernel's priority, from the
+ * timer ISR, from other ISRs, or from the SYSCALL_USLEEP and
+ * SYSCALL_HRTIMER_SET handlers, so the wheel needs no locking.
+ *
+ * Slot numbers are expiries in units of HRTIMER_SLOT_CYCLES, rounded up, and
+ * hrtimer_clock is the first slot not yet expired. A timer whose slot is d
+ * slots ahead of the clock sits at the lowest level L with d < 64^(L+1), at
+ * index (slot >> 6L) & 63. Level 0 slots expire when the clock reaches
+ * them; a level L slot is cascaded, i.e. its timers are placed again, one or
+ * more levels down, when the clock reaches the start of the 64^L slot period
+ * it stands for. The clock jumps straight from one of these events to the
+ * next, so empty slots cost nothing.
+ */
+
+#include "hrtimer.h"
+#include "board.h"
+#include "kernel.h"
+#include "sched.h"
+#include "syscalls.h"
+#include "trace.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HRTIMER_LEVEL_BITS (6)
+#define HRTIMER_LEVEL_SLOTS (1 << HRTIMER_LEVEL_BITS)
+#define HRTIMER_LEVEL_MASK (HRTIMER_LEVEL_SLOTS - 1)
+#define HRTIMER_NO_SLOT (UINT32_MAX)
+
+// Slots ahead of the clock that the top level reaches
+#define HRTIMER_SPAN (1ull << (HRTIMER_LEVEL_BITS * HRTIMER_LEVELS))
+
+#define HRTIMER_CYCLES_PER_US (F_CPU / 1000000)
+
+static swtimer_link_t hrtimer_wheel[HRTIMER_LEVELS][HRTIMER_LEVEL_SLOTS];
+static uint64_t hrtimer_pending[HRTIMER_LEVELS];
+static uint64_t hrtimer_clock;
+static bool hrtimer_ready;
+
+// Set while hrtimer_isr() is expiring timers; it reprograms the board timer
+// itself when it is done
+static bool hrtimer_in_isr;
+
+// The timers that sys_usleep() blocks on, one per thread table slot
+static hrtimer_t hrtimer_sleepers[MAX_THREADS];
+
+static void hrtimer_append(swtimer_link_t* head, swtimer_link_t* link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void hrtimer_unlink(swtimer_link_t* link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = link->prev = NULL;
+}
+
+/*
+ * Sets up the wheel and the board timer the first time a timer is set, so
+ * that programs that use no high-resolution timers pay nothing for them.
+ */
+static void hrtimer_setup(void)
+{
+    int i, j;
+
+    for(i = 0; i < HRTIMER_LEVELS; i++)
+        for(j = 0; j < HRTIMER_LEVEL_SLOTS; j++)
+            hrtimer_wheel[i][j].next = hrtimer_wheel[i][j].prev =
+                    &hrtimer_wheel[i][j];
+
+    hrtimer_clock = kernel_time_cycles() >> HRTIMER_SLOT_SHIFT;
+    board_hrtimer_init();
+    hrtimer_ready = true;
+}
+
+static bool hrtimer_empty(void)
+{
+    int i;
+
+    for(i = 0; i < HRTIMER_LEVELS; i++)
+        if(hrtimer_pending[i])
+            return false;
+    return true;
+}
+
+/*
+ * Puts a timer in the wheel slot for its expiry, relative to the clock.
+ */
+static void hrtimer_place(hrtimer_t* timer)
+{
+    uint64_t slot = (timer->expiry + HRTIMER_SLOT_CYCLES - 1) >>
+                    HRTIMER_SLOT_SHIFT;
+    uint64_t delta;
+    uint32_t level, index;
+
+    // Already due: expire it at the next opportunity
+    if(slot < hrtimer_clock)
+        slot = hrtimer_clock;
+
+    // Beyond the top level: park it in the farthest slot, from which it is
+    // cascaded and placed again
+    delta = slot - hrtimer_clock;
+    if(delta >= HRTIMER_SPAN)
+    {
+        slot = hrtimer_clock + HRTIMER_SPAN - 1;
+        delta = HRTIMER_SPAN - 1;
+    }
+
+    for(level = 0; level < HRTIMER_LEVELS - 1; level++)
+        if(delta < (1ull << (HRTIMER_LEVEL_BITS * (level + 1))))
+            break;
+
+    index = (slot >> (HRTIMER_LEVEL_BITS * level)) & HRTIMER_LEVEL_MASK;
+    timer->slot = level * HRTIMER_LEVEL_SLOTS + index;
+    hrtimer_append(&hrtimer_wheel[level][index], &timer->link);
+    hrtimer_pending[level] |= 1ull << index;
+}
+
+static void hrtimer_remove(hrtimer_t* timer)
+{
+    uint32_t level, index;
+
+    if(!timer->link.next)
+        return;
+
+    hrtimer_unlink(&timer->link);
+
+    if(timer->slot != HRTIMER_NO_SLOT)
+    {
+        level = timer->slot / HRTIMER_LEVEL_SLOTS;
+        index = timer->slot % HRTIMER_LEVEL_SLOTS;
+        if(hrtimer_wheel[level][index].next == &hrtimer_wheel[level][index])
+            hrtimer_pending[level] &= ~(1ull << index);
+    }
+}
+
+/*
+ * Returns the slot number of the next wheel event: the first non-empty
+ * level 0 slot, or the start of the period of the first non-empty slot of a
+ * higher level, whichever comes first. UINT64_MAX if the wheel is empty.
+ */
+static uint64_t hrtimer_next_event(void)
+{
+    uint64_t next = UINT64_MAX;
+    uint64_t bits, period, event;
+    uint32_t level, shift, pos, dist;
+
+    for(level = 0; level < HRTIMER_LEVELS; level++)
+    {
+        if(!hrtimer_pending[level])
+            continue;
+
+        shift = HRTIMER_LEVEL_BITS * level;
+        period = hrtimer_clock >> shift;
+        pos = period & HRTIMER_LEVEL_MASK;
+
+        // Distance from the current index to the next occupied one
+        bits = hrtimer_pending[level];
+        bits = pos ? (bits >> pos) | (bits << (HRTIMER_LEVEL_SLOTS - pos))
+                   : bits;
+        dist = __builtin_ctzll(bits);
+
+        if(level == 0)
+        {
+            event = hrtimer_clock + dist;
+        }
+        else
+        {
+            // The current index's period has already been cascaded, so a
+            // timer there belongs to the next lap
+            event = (period + (dist ? dist : HRTIMER_LEVEL_SLOTS)) << shift;
+        }
+
+        if(event < next)
+            next = event;
+    }
+
+    return next;
+}
+
+/*
+ * Advances the clock to event, which must be hrtimer_next_event(), and
+ * runs the timers that expire there.
+ */
+static void hrtimer_advance(uint64_t event)
+{
+    swtimer_link_t due;
+    swtimer_link_t* head;
+    hrtimer_t* timer;
+    uint64_t now;
+    uint32_t level, shift, index;
+
+    hrtimer_clock = event;
+
+    // Cascade from the top down, so that timers moved into a lower level's
+    // current slot are handled in the same pass
+    for(level = HRTIMER_LEVELS - 1; level > 0; level--)
+    {
+        shift = HRTIMER_LEVEL_BITS * level;
+        if(event & ((1ull << shift) - 1))
+            continue;
+
+        index = (event >> shift) & HRTIMER_LEVEL_MASK;
+        if(!(hrtimer_pending[level] & (1ull << index)))
+            continue;
+
+        head = &hrtimer_wheel[level][index];
+        hrtimer_pending[level] &= ~(1ull << index);
+        while(head->next != head)
+        {
+            timer = (hrtimer_t*) head->next;
+            hrtimer_unlink(&timer->link);
+            hrtimer_place(timer);
+        }
+    }
+
+    // Take the expired slot's timers off the wheel before running any
+    // callbacks, which may set or cancel timers
+    index = event & HRTIMER_LEVEL_MASK;
+    head = &hrtimer_wheel[0][index];
+    due.next = due.prev = &due;
+    if(hrtimer_pending[0] & (1ull << index))
+    {
+        hrtimer_pending[0] &= ~(1ull << index);
+        due.next = head->next;
+        due.prev = head->prev;
+        due.next->prev = due.prev->next = &due;
+        head->next = head->prev = head;
+    }
+    hrtimer_clock = event + 1;
+
+    now = kernel_time_cycles();
+    while(due.next != &due)
+    {
+        timer = (hrtimer_t*) due.next;
+        hrtimer_unlink(&timer->link);
+        timer->slot = HRTIMER_NO_SLOT;
+
+        if(timer->period)
+        {
+            timer->expiry += timer->period;
+            if(timer->expiry <= now)
+            {
+                uint32_t missed = (now - timer->expiry) / timer->period + 1;
+
+                timer->expiry += (uint64_t) missed * timer->period;
+                timer->overruns += missed;
+            }
+            hrtimer_place(timer);
+        }
+
+        timer->fn(timer->ctx);
+    }
+}
+
+/*
+ * Expires every timer that is due, then programs the board timer for the
+ * next deadline, or stops it if there is none.
+ */
+static void hrtimer_update(void)
+{
+    uint64_t event, now, at;
+
+    while(1)
+    {
+        event = hrtimer_next_event();
+        if(event == UINT64_MAX)
+        {
+            board_hrtimer_stop();
+            return;
+        }
+
+        now = kernel_time_cycles();
+        at = event << HRTIMER_SLOT_SHIFT;
+        if(at > now)
+        {
+            // The board timer is 32 bits wide; a deadline further away than
+            // that takes an early interrupt that finds nothing due
+            board_hrtimer_arm(at - now < UINT32_MAX ? (uint32_t)(at - now)
+                                                    : UINT32_MAX);
+            return;
+        }
+
+        hrtimer_advance(event);
+    }
+}
+
+/**
+ * @brief Stops timer, wherever it is, and restarts it to expire delay_us
+ * from now and then every period_us. A delay of 0 only stops it. Callable
+ * from the kernel, ISRs, and timer callbacks.
+ *
+ * A cancelled timer may leave the board timer programmed for its deadline;
+ * that interrupt finds nothing due and reprograms it.
+ */
+void hrtimer_set(hrtimer_t* timer, uint32_t delay_us, uint32_t period_us)
+{
+    uint64_t now;
+
+    hrtimer_remove(timer);
+
+    if(!delay_us)
+        return;
+
+    if(!hrtimer_ready)
+        hrtimer_setup();
+
+    now = kernel_time_cycles();
+
+    // An idle wheel restarts from the present, so that new timers are
+    // placed precisely rather than cascaded from a stale clock
+    if(hrtimer_empty() && (now >> HRTIMER_SLOT_SHIFT) > hrtimer_clock)
+        hrtimer_clock = now >> HRTIMER_SLOT_SHIFT;
+
+    timer->expiry = now + (uint64_t) delay_us * HRTIMER_CYCLES_PER_US;
+    timer->period = period_us * HRTIMER_CYCLES_PER_US;
+    timer->overruns = 0;
+    hrtimer_place(timer);
+
+    if(!hrtimer_in_isr)
+        hrtimer_update();
+}
+
+static void hrtimer_wake(void* ctx)
+{
+    thread_t* thread = (thread_t*) ctx;
+
+    // The thread may have been killed while it slept
+    if(thread->state != T_BLOCKED || thread->waitstat != WAITSTATUS_USLEEP)
+        return;
+
+    thread->waitstat = WAITSTATUS_NONE;
+    kernel_wake(thread);
+    trace_event(TRACE_WAKEUP, thread->id, 0);
+}
+
+/**
+ * @brief Blocks thread for us microseconds. Called by the SYSCALL_USLEEP
+ * handler, which then schedules; the thread may already be runnable again by
+ * the time this returns, if us is shorter than the time it takes.
+ */
+void hrtimer_sleep(thread_t* thread, uint32_t us)
+{
+    hrtimer_t* timer = &hrtimer_sleepers[thread_pos(thread)];
+
+    timer->fn = hrtimer_wake;
+    timer->ctx = thread;
+
+    thread->waitstat = WAITSTATUS_USLEEP;
+    thread->state = T_BLOCKED;
+    sched_dequeue(thread);
+    hrtimer_set(timer, us, 0);
+}
+
+/**
+ * @brief The board timer's interrupt handler calls this once it has
+ * acknowledged the interrupt.
+ */
+void hrtimer_isr(void)
+{
+    if(!hrtimer_ready)
+        return;
+
+    hrtimer_in_isr = true;
+    hrtimer_update();
+    hrtimer_in_isr = false;
+}
+
+/**
+ * @brief Prepares a timer. It does nothing until hrtimer_start().
+ */
+void hrtimer_init(hrtimer_t* timer, void (*fn)(void*), void* ctx)
+{
+    timer->link.next = timer->link.prev = NULL;
+    timer->slot = HRTIMER_NO_SLOT;
+    timer->fn = fn;
+    timer->ctx = ctx;
+    timer->period = 0;
+    timer->overruns = 0;
+}
+
+/**
+ * @brief Starts (or restarts) a timer from a thread.
+ *
+ * @param delay_us Time until the first call; at least 1.
+ * @param period_us Time between later calls; 0 for a one-shot timer. At
+ * most 2^32 cycles.
+ */
+void hrtimer_start(hrtimer_t* timer, uint32_t delay_us, uint32_t period_us)
+{
+    sys_hrtimer_set(timer, delay_us ? delay_us : 1, period_us);
+}
+
+/**
+ * @brief Stops a timer from a thread. Its callback will not be called again.
+ */
+void hrtimer_cancel(hrtimer_t* timer)
+{
+    sys_hrtimer_set(timer, 0, 0);
+}
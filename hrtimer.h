@@ -0,0 +1,74 @@
+/*
+ * hrtimer.h
+ *
+ * High-resolution timers, for periods well below the 1 ms scheduler tick.
+ * An hrtimer_t calls fn(ctx) once, delay_us after it is started, and then
+ * every period_us if it is periodic; sys_usleep() blocks the calling thread
+ * on one. The time base is kernel_time_cycles(), so deadlines have a
+ * resolution of HRTIMER_SLOT_CYCLES.
+ *
+ * The board's high-resolution timer (a GPTM on the TM4C123, a CMSDK timer on
+ * the MPS2; see board_hrtimer_arm()) runs in one-shot mode and is always
+ * programmed for the earliest pending deadline, so it interrupts only when a
+ * timer is due. Timers live in a hierarchical timing wheel of HRTIMER_LEVELS
+ * levels of 64 slots, each level's slots 64 times as wide as the one below,
+ * with a 64-bit occupancy bitmap per level. Starting and cancelling a timer
+ * and finding the earliest deadline take a bounded number of steps, whatever
+ * the number of armed timers. A timer is moved down a level at most
+ * HRTIMER_LEVELS - 1 times before it expires.
+ *
+ * Callbacks run in interrupt context, from the timer's ISR, and must be
+ * short: wake a thread with kernel_event_signal(), or hand the work to
+ * work_defer(). A periodic timer's next expiry is its previous expiry plus
+ * the period, so it does not drift; if a whole period is missed, the missed
+ * expiries are skipped and counted in overruns.
+ *
+ * The wheel belongs to the kernel. Threads use hrtimer_start() and
+ * hrtimer_cancel(), which are system calls; ISRs and callbacks, which run at
+ * the kernel's priority, call hrtimer_set() directly.
+ */
+
+#ifndef HRTIMER_H_
+#define HRTIMER_H_
+
+#include "swtimer.h"
+#include "thread.h"
+
+#include <stdint.h>
+
+// log2 of the slot width, in cycles
+#ifndef HRTIMER_SLOT_SHIFT
+#define HRTIMER_SLOT_SHIFT (6)
+#endif
+
+#define HRTIMER_SLOT_CYCLES (1u << HRTIMER_SLOT_SHIFT)
+#define HRTIMER_LEVELS (4)
+
+// Type for a high-resolution timer
+typedef struct
+{
+    // Wheel slot membership; NULL next when not armed. Must be the first
+    // member.
+    swtimer_link_t link;
+    // Expiry, in kernel_time_cycles()
+    uint64_t expiry;
+    // In cycles; 0 for a one-shot timer
+    uint32_t period;
+    // Wheel slot, level * 64 + index, or HRTIMER_NO_SLOT
+    uint32_t slot;
+    void (*fn)(void* ctx);
+    void* ctx;
+    // Periodic expiries skipped because they were already past
+    uint32_t overruns;
+} hrtimer_t;
+
+void hrtimer_init(hrtimer_t* timer, void (*fn)(void*), void* ctx);
+void hrtimer_start(hrtimer_t* timer, uint32_t delay_us, uint32_t period_us);
+void hrtimer_cancel(hrtimer_t* timer);
+
+// Kernel and ISR side; see hrtimer.c
+void hrtimer_set(hrtimer_t* timer, uint32_t delay_us, uint32_t period_us);
+void hrtimer_sleep(thread_t* thread, uint32_t us);
+void hrtimer_isr(void);
+
+#endif /* HRTIMER_H_ */
@@ -6,9 +6,19 @@
  */
 
 #include "os_utils.h"
+#include "heap.h"
+#include "hrtimer.h"
 #include "kernel.h"
+#include "port.h"
+#include "profile.h"
+#include "sched.h"
+#include "swtimer.h"
 #include "thread.h"
+#include "trace.h"
 #include <string.h>
+#if THREAD_REENT
+#include <reent.h>
+#endif
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -21,13 +31,38 @@ extern "C" {
  * Kernel stack. Used while in kernel space.
  */
 uint8_t kernel_stack[KERNEL_STACKSIZE] __attribute((aligned(8)));
-uint32_t kernel_stack_top;
+uintptr_t kernel_stack_top;
 
 /*
- * Scheduler timekeeping.
+ * Scheduler timekeeping. systime_hi:systime_ms is the 64-bit tick count (see
+ * port_time()); next_wake is the earliest tick at which a sleeping thread is
+ * due, or UINT64_MAX if none is.
  */
 tsleep_t systime_ms;
-tsleep_t next_to_run_ms;
+uint32_t systime_hi;
+uint64_t next_wake;
+
+/*
+ * CPU accounting. kernel_account_stamp is the port_cycles() value up to which
+ * thread_current has been charged; kernel_from_tick is set while the kernel
+ * is handling a scheduler tick or a wakeup from an ISR, so that kernel_run()
+ * can count preemptions.
+ */
+uint32_t kernel_account_stamp;
+bool kernel_from_tick;
+
+/*
+ * Set when a thread that should preempt thread_current wakes up (see
+ * sched_preempts()). With KERNEL_WAKE_PREEMPT the kernel switches to it on
+ * the way out of the system call or ISR that woke it; otherwise the next
+ * scheduler tick does, without waiting for the time slice to end.
+ */
+volatile bool kernel_need_resched;
+
+#define KERNEL_CYCLES_PER_TICK (F_CPU / KERNEL_SCHEDULER_IRQ_FREQ)
+
+// Fractional bits of a thread's virtual time
+#define KERNEL_FAIR_SHIFT (10)
 
 /*
  * Forward declarations
@@ -35,7 +70,7 @@ tsleep_t next_to_run_ms;
 void kernel_schedule();
 void kernel_run(thread_t* thread);
 void kernel_panic();
-inline void kernel_assert(bool cond);
+static inline void kernel_assert(bool cond);
 void kernel_set_scheduler_freq(uint32_t freq);
 __attribute__((noreturn))
 extern void kernel_exit(void);
@@ -53,33 +88,21 @@ extern void kernel_exit(void);
  */
 void kernel_init(void* current_stack_top)
 {
-    kernel_stack_top = (uint32_t)kernel_stack + sizeof(kernel_stack);
+    kernel_stack_top = (uintptr_t)kernel_stack + sizeof(kernel_stack);
     thread_init();
 
-    // Relocate the caller's stack into the thread 0 stack slot. The caller
-    // should not have created any pointers into their stack, otherwise this
-    // will result in catastrophe.
-    asm volatile(
-        "mov r3,%0\r\n"
-        "mov r0,%1\r\n"
-        "mov r1,sp\r\n"
-        "sub r2,r3,r1\r\n"
-        "sub r0,r2\r\n"
-        "push {r0}\r\n"
-        "bl memcpy\r\n"
-        "pop {r0}\r\n"
-        "dsb\r\n"
-        "isb\r\n"
-        "mov sp,r0\r\n"
-     : : "r" (current_stack_top), "r" (&(thread_mem[0][THREAD_MEM_SIZE])) :
-     "memory", "0", "1", "2", "3" );
+    // Move the caller onto the thread 0 stack slot; see port.h.
+    PORT_ADOPT_STACK(current_stack_top, &(thread_mem[0][THREAD_MEM_SIZE]));
 
     thread_table[0].state = T_RUNNABLE;
     thread_table[0].id = 0;
     thread_current = &thread_table[0];
+    sched_enqueue(thread_current);
 
     systime_ms = 0;
-    next_to_run_ms = UINT32_MAX;
+    systime_hi = 0;
+    next_wake = UINT64_MAX;
+    swtimer_kernel_init();
 
     int i;
     for(i = 0; i < MAX_THREADS; i++)
@@ -90,7 +113,9 @@ void kernel_init(void* current_stack_top)
         kernel_assert(thread_in_table(&thread_table[i]));
     }
 
+    port_irq_init();
     kernel_set_scheduler_freq(KERNEL_SCHEDULER_IRQ_FREQ);
+    kernel_account_stamp = port_cycles();
 }
 
 /**
@@ -99,53 +124,54 @@ void kernel_init(void* current_stack_top)
  */
 void kernel_panic()
 {
-    // Disable interrupts
-    while(1)
-    {
-        ;
-    }
+    port_halt();
 }
 
-inline void kernel_assert(bool cond)
+static inline void kernel_assert(bool cond)
 {
     if(!cond)
         kernel_panic();
 }
 
+/*
+ * The 64-bit tick count, for use in the kernel, where the tick cannot land
+ * between the two reads.
+ */
+static inline uint64_t kernel_now(void)
+{
+    return ((uint64_t) systime_hi << 32) | systime_ms;
+}
+
+/**
+ * @brief Charges thread_current for the cycles it has used since it was last
+ * charged. This is a subtraction and an add on the switch path, plus a
+ * division to advance the thread's virtual time with KERNEL_FAIR_SHARE.
+ */
+static inline void kernel_account(void)
+{
+    uint32_t now = port_cycles();
+    uint32_t used = now - kernel_account_stamp;
+
+    thread_current->cycles += used;
+#if KERNEL_FAIR_SHARE
+    thread_current->pass += ((uint64_t) used << KERNEL_FAIR_SHIFT) /
+                            thread_current->weight;
+#endif
+    kernel_account_stamp = now;
+}
+
 /**
  * @brief Schedule a different thread to run. This is invoked from kernel space.
  *
- * This is a simple round-robin scheduler. It checks all threads for one that
- * is runnable, and runs the first such one.
+ * The scheduling policy picks the thread; see sched.h.
  */
 __attribute__((noreturn))
 void kernel_schedule()
 {
-    uint32_t i = thread_pos(thread_current), original_i;
-
-    // If the current thread has an invalid index, then something went wrong...
-    if(i >= MAX_THREADS)
-        kernel_panic();
-
-    i++;
-    if (i == MAX_THREADS)
-        i = 0;
+    thread_t* thread = sched_pick();
 
-    original_i = i;
-
-    while (1)
-    {
-        if (thread_table[i].state == T_RUNNABLE)
-        {
-            kernel_run(&thread_table[i]);
-        }
-
-        i++;
-        if(i == MAX_THREADS)
-            i = 0;
-        if(i == original_i)
-            break;
-    }
+    if(thread)
+        kernel_run(thread);
 
     /*
      * No runnable threads found. This can occur if all threads are sleeping.
@@ -163,7 +189,37 @@ void kernel_schedule()
 __attribute__((noreturn))
 void kernel_run(thread_t* thread)
 {
+#if KERNEL_WAKE_PREEMPT
+    // Rather than return to a thread that a wakeup during this pass through
+    // the kernel should preempt, pick again
+    if(kernel_need_resched && thread == thread_current &&
+       !thread->preempt_count)
+    {
+        kernel_need_resched = false;
+        kernel_schedule();
+    }
+    port_cancel_switch();
+#endif
+
+    trace_event(TRACE_RUN, thread->id, 0);
+
+    kernel_account();
+    if(thread != thread_current)
+    {
+        thread->nswitch++;
+        if(kernel_from_tick && thread_current->state == T_RUNNABLE)
+            thread_current->npreempt++;
+    }
+    kernel_from_tick = false;
+    // A thread that has preemption disabled takes the switch with it, to
+    // make in preempt_enable()
+    if(!thread->preempt_count)
+        kernel_need_resched = false;
+
     thread_current = thread;
+#if THREAD_REENT
+    _impure_ptr = thread->reent;
+#endif
 
     kernel_exit();
 
@@ -172,10 +228,152 @@ void kernel_run(thread_t* thread)
         ;
 }
 
+/**
+ * @brief Puts a thread to sleep for the given number of scheduler ticks.
+ */
+static void kernel_sleep(thread_t* thread, tsleep_t ticks)
+{
+    thread->wake = kernel_now() + ticks;
+
+    if(thread->wake < next_wake)
+        next_wake = thread->wake;
+
+    thread->state = T_SLEEPING;
+    sched_dequeue(thread);
+}
+
+/**
+ * @brief Limits a thread to budget ticks of CPU time every period ticks,
+ * starting with a full budget now. A budget of 0 lifts the limit.
+ */
+static void kernel_budget_set(thread_t* thread, uint32_t budget,
+                              uint32_t period)
+{
+    thread->budget = budget < period ? budget : 0;
+    thread->budget_period = period;
+    thread->budget_mark = thread->cycles;
+    thread->replenish = kernel_now() + period;
+}
+
+/**
+ * @brief Checks the running thread's budget, from kernel_tick_counter().
+ * What the thread has used is measured in cycles, by kernel_account(), so a
+ * thread is not charged a whole tick for part of one; the budget is only
+ * enforced at ticks, though, so a thread can overrun it by up to a tick.
+ * The budget is refilled at each replenishment tick, lazily, the next time
+ * the thread is checked. A thread with preemption disabled is not checked.
+ * A thread that uses up its budget counts an overrun and sleeps until the
+ * next replenishment.
+ */
+static void kernel_budget_charge(thread_t* thread, uint64_t now)
+{
+    if(!thread->budget || thread->preempt_count)
+        return;
+
+    kernel_account();
+
+    if(now >= thread->replenish)
+    {
+        thread->budget_mark = thread->cycles;
+        thread->replenish = now + thread->budget_period -
+                (now - thread->replenish) % thread->budget_period;
+    }
+
+    if(thread->cycles - thread->budget_mark <
+       (uint64_t) thread->budget * KERNEL_CYCLES_PER_TICK)
+        return;
+
+    thread->noverrun++;
+    thread->waitstat = WAITSTATUS_NONE;
+    kernel_sleep(thread, thread->replenish - now);
+    trace_event(TRACE_THROTTLE, thread->id, 0);
+}
+
+/*
+ * Utilization of a thread's parameters, in thousandths of the CPU, rounded
+ * up. A deadline shorter than the period counts in place of the period
+ * (the density test), which is sufficient for constrained deadlines.
+ */
+static uint32_t kernel_edf_util(uint32_t budget, uint32_t period,
+                                uint32_t deadline)
+{
+    uint32_t window = deadline < period ? deadline : period;
+
+    return (uint32_t)(((uint64_t) budget * 1000 + window - 1) / window);
+}
+
+/**
+ * @brief Makes thread earliest-deadline-first with the given parameters, in
+ * ticks, if the earliest-deadline-first threads would still fit within
+ * EDF_UTIL_BOUND; its first job is released now. A period of 0 makes it
+ * best-effort again. Only SCHED_POLICY_EDF has the class.
+ *
+ * @return true if the thread was admitted.
+ */
+static bool kernel_edf_set(thread_t* thread, uint32_t period, uint32_t budget,
+                           uint32_t deadline)
+{
+    uint32_t i, util = 0;
+
+    if(KERNEL_SCHED_POLICY != SCHED_POLICY_EDF)
+        return !period;
+
+    if(!period)
+    {
+        // Moves from the class's queue to its priority's
+        if(thread->edf_period)
+        {
+            sched_dequeue(thread);
+            thread->edf_period = 0;
+            if(thread->state == T_RUNNABLE)
+                sched_enqueue(thread);
+        }
+        kernel_budget_set(thread, 0, 0);
+        return true;
+    }
+
+    if(!deadline)
+        deadline = period;
+    if(!budget || budget > deadline || deadline > period)
+        return false;
+
+    for(i = 0; i < MAX_THREADS; i++)
+    {
+        const thread_t* t = &thread_table[i];
+
+        if(t != thread && t->edf_period && t->state != T_EMPTY &&
+           t->state != T_ZOMBIE)
+            util += kernel_edf_util(t->edf_budget, t->edf_period,
+                                    t->edf_deadline);
+    }
+    if(util + kernel_edf_util(budget, period, deadline) > EDF_UTIL_BOUND)
+        return false;
+
+    // The run queue it is on depends on its class and deadline
+    sched_dequeue(thread);
+    thread->edf_period = period;
+    thread->edf_budget = budget;
+    thread->edf_deadline = deadline;
+    thread->edf_release = kernel_now();
+    thread->edf_due = thread->edf_release + deadline;
+    if(thread->state == T_RUNNABLE)
+        sched_enqueue(thread);
+
+    // A job that runs past its budget waits for the next release, so that
+    // it cannot take time admission promised to others
+    kernel_budget_set(thread, budget, period);
+    return true;
+}
+
 __attribute__((noreturn))
 void kernel_handle_syscall()
 {
     thread_t* child_thread;
+    tsleep_t tick;
+
+    trace_event(TRACE_SYSCALL, thread_current->id, thread_current->regs.R0);
+    thread_current->nsyscall++;
+
     switch (thread_current->regs.R0)
     {
     // Get the thread ID of the calling process
@@ -192,6 +390,7 @@ void kernel_handle_syscall()
         break;
 
     case SYSCALL_YIELD:
+        thread_current->slice = 0;
         kernel_schedule();
         break;
 
@@ -213,6 +412,7 @@ void kernel_handle_syscall()
     case SYSCALL_UNLOCK:
         // Release the lock
         *((lock_t*) thread_current->regs.R1) = LOCK_UNLOCKED;
+        thread_current->slice = 0;
         kernel_schedule();
         break;
 
@@ -223,6 +423,7 @@ void kernel_handle_syscall()
             // Set the correct return values
             child_thread->regs.R0 = 0;
             thread_current->regs.R0 = child_thread->id;
+            sched_enqueue(child_thread);
         }
         else
         {
@@ -234,15 +435,10 @@ void kernel_handle_syscall()
     case SYSCALL_SLEEP:
         if (thread_current->regs.R1 > 0)
         {
-            thread_current->scnt = thread_current->regs.R0 =
+            thread_current->regs.R0 =
                     (thread_current->regs.R1 / SYSTIME_CYCLES_PER_MS);
-
-            thread_current->scnt += systime_ms;
-
-            if((thread_current->scnt - systime_ms) < (next_to_run_ms - systime_ms))
-                next_to_run_ms = thread_current->scnt;
-
-            thread_current->state = T_SLEEPING;
+            thread_current->waitstat = WAITSTATUS_NONE;
+            kernel_sleep(thread_current, thread_current->regs.R0);
             kernel_schedule();
         }
         else
@@ -252,6 +448,50 @@ void kernel_handle_syscall()
         }
         break;
 
+    case SYSCALL_SLEEP_UNTIL:
+        // Sleep until an absolute time. If it has already passed, return
+        // at once with how late the caller is, in milliseconds.
+        tick = thread_current->regs.R1 / SYSTIME_CYCLES_PER_MS;
+        if ((int32_t)(tick - systime_ms) > 0)
+        {
+            thread_current->regs.R0 = 0;
+            thread_current->waitstat = WAITSTATUS_NONE;
+            kernel_sleep(thread_current, tick - systime_ms);
+            kernel_schedule();
+        }
+        thread_current->regs.R0 = (systime_ms - tick) * SYSTIME_CYCLES_PER_MS;
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_USLEEP:
+        if (thread_current->regs.R1 > 0)
+        {
+            hrtimer_sleep(thread_current, thread_current->regs.R1);
+            kernel_schedule();
+        }
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_HRTIMER_SET:
+        hrtimer_set((hrtimer_t*) thread_current->regs.R1,
+                    (uint32_t) thread_current->regs.R2,
+                    (uint32_t) thread_current->regs.R3);
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_HEAP:
+        thread_current->regs.R0 = (reg_t) heap_kernel(
+            (uint32_t) thread_current->regs.R1,
+            (void*) thread_current->regs.R2,
+            (size_t) thread_current->regs.R3);
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_TIME:
+        thread_current->regs.R0 = systime_ms * SYSTIME_CYCLES_PER_MS;
+        kernel_run(thread_current);
+        break;
+
     case SYSCALL_KILL:
         child_thread = tt_entry_for_tid((tid_t)thread_current->regs.R1);
         if(child_thread)
@@ -266,13 +506,21 @@ void kernel_handle_syscall()
         kernel_run(thread_current);
 
     case SYSCALL_RESET:
-        dptr(0xE000ED0C) = 0x05FA0004;
+        port_reset();
         break;
 
     case SYSCALL_SPAWN:
-        thread_current->regs.R0 = (uint32_t) thread_spawn(
+    case SYSCALL_SPAWN_ATTR:
+        thread_current->regs.R0 = (reg_t) thread_spawn_attr(
                 (const int(*)(void*)) thread_current->regs.R1,
-                (const void*) thread_current->regs.R2);
+                (const void*) thread_current->regs.R2,
+                thread_current->regs.R0 == SYSCALL_SPAWN_ATTR ?
+                        (const thread_attr_t*) thread_current->regs.R3 : NULL);
+        // A failed spawn returns 0, which is also thread 0's tid
+        child_thread = thread_current->regs.R0 ?
+                tt_entry_for_tid((tid_t) thread_current->regs.R0) : NULL;
+        if (child_thread)
+            sched_enqueue(child_thread);
 
         kernel_schedule();
         break;
@@ -282,6 +530,7 @@ void kernel_handle_syscall()
         {
         thread_current->state = T_BLOCKED;
         thread_current->waitstat = WAITSTATUS_THREAD;
+        sched_dequeue(thread_current);
 
         // The thread id that thread_current is waiting on
         // is stored in R1
@@ -289,6 +538,130 @@ void kernel_handle_syscall()
         }
         kernel_run(thread_current);
         break;
+
+    case SYSCALL_EVENT_WAIT:
+        // Only block if the event has not been signalled since the caller
+        // sampled it. The event address stays in R1 for
+        // kernel_event_signal() to match against. A timed wait sleeps with
+        // R0 = false, which kernel_event_signal() overwrites if the event
+        // comes first.
+        thread_current->regs.R0 = true;
+        if (*((event_t*) thread_current->regs.R1) ==
+            (uint32_t) thread_current->regs.R2)
+        {
+            if (thread_current->regs.R3 == EVENT_WAIT_FOREVER)
+            {
+                thread_current->state = T_BLOCKED;
+                sched_dequeue(thread_current);
+            }
+            else if (thread_current->regs.R3 / SYSTIME_CYCLES_PER_MS)
+            {
+                thread_current->regs.R0 = false;
+                kernel_sleep(thread_current,
+                        thread_current->regs.R3 / SYSTIME_CYCLES_PER_MS);
+            }
+            else
+            {
+                thread_current->regs.R0 = false;
+                kernel_run(thread_current);
+            }
+            thread_current->waitstat = WAITSTATUS_EVENT;
+            kernel_schedule();
+        }
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_TIMER_SET:
+        swtimer_set((swtimer_t*) thread_current->regs.R1,
+                thread_current->regs.R2 / SYSTIME_CYCLES_PER_MS,
+                thread_current->regs.R3 / SYSTIME_CYCLES_PER_MS);
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_TIMER_NEXT:
+        // Block until swtimer_tick() hands over an expired timer in R0
+        thread_current->regs.R0 = (reg_t) swtimer_next();
+        if (!thread_current->regs.R0)
+        {
+            thread_current->state = T_BLOCKED;
+            thread_current->waitstat = WAITSTATUS_TIMER;
+            swtimer_waiter = thread_current;
+            sched_dequeue(thread_current);
+            kernel_schedule();
+        }
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_EDF_SET:
+        thread_current->regs.R0 = kernel_edf_set(thread_current,
+                thread_current->regs.R1 / SYSTIME_CYCLES_PER_MS,
+                thread_current->regs.R2 / SYSTIME_CYCLES_PER_MS,
+                thread_current->regs.R3 / SYSTIME_CYCLES_PER_MS);
+        kernel_schedule();
+        break;
+
+    case SYSCALL_EDF_WAIT:
+        // Finish the current job, note whether it was on time, and sleep
+        // until the next one is released. A job released late runs at once.
+        if (!thread_current->edf_period)
+        {
+            thread_current->regs.R0 = false;
+            kernel_run(thread_current);
+        }
+        thread_current->regs.R0 = kernel_now() <= thread_current->edf_due;
+        if (!thread_current->regs.R0)
+            thread_current->nmiss++;
+
+        // Off the run queue while the deadline it is sorted by moves
+        sched_dequeue(thread_current);
+        thread_current->edf_release += thread_current->edf_period;
+        thread_current->edf_due =
+                thread_current->edf_release + thread_current->edf_deadline;
+        if (thread_current->edf_release > kernel_now())
+        {
+            thread_current->waitstat = WAITSTATUS_NONE;
+            kernel_sleep(thread_current,
+                    thread_current->edf_release - kernel_now());
+        }
+        else
+        {
+            sched_enqueue(thread_current);
+        }
+        kernel_schedule();
+        break;
+
+    case SYSCALL_SET_WEIGHT:
+        child_thread = tt_entry_for_tid((tid_t) thread_current->regs.R1);
+        thread_current->regs.R0 = child_thread && thread_current->regs.R2;
+        if (thread_current->regs.R0)
+        {
+            // The running thread is charged at its old weight first
+            kernel_account();
+            child_thread->weight = (uint32_t) thread_current->regs.R2;
+        }
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_SET_BUDGET:
+        child_thread = tt_entry_for_tid((tid_t) thread_current->regs.R1);
+        thread_current->regs.R0 = child_thread &&
+                !child_thread->edf_period &&
+                thread_current->regs.R2 < thread_current->regs.R3;
+        if (thread_current->regs.R0)
+            kernel_budget_set(child_thread,
+                    thread_current->regs.R2 / SYSTIME_CYCLES_PER_MS,
+                    thread_current->regs.R3 / SYSTIME_CYCLES_PER_MS);
+        kernel_run(thread_current);
+        break;
+
+    case SYSCALL_THREAD_STATS:
+        // Bring the caller's own numbers up to date before copying them
+        kernel_account();
+        thread_current->regs.R0 = thread_stats(
+                (tstat_t*) thread_current->regs.R1,
+                (uint32_t) thread_current->regs.R2);
+        kernel_run(thread_current);
+        break;
     }
 
     // Unknown system call
@@ -301,50 +674,201 @@ void kernel_handle_syscall()
 
 void kernel_tick_counter(void)
 {
-    systime_ms++;
+    uint64_t now;
+
+    kernel_from_tick = true;
+    profile_sample(thread_current->id, thread_current->regs.PC);
+    if(++systime_ms == 0)
+        systime_hi++;
+    swtimer_tick();
 
-    if(systime_ms != next_to_run_ms)
+    now = kernel_now();
+    kernel_budget_charge(thread_current, now);
+    if(now < next_wake)
         return;
 
-    next_to_run_ms = UINT32_MAX;
+    next_wake = UINT64_MAX;
 
     int i;
     for (i = 0; i < MAX_THREADS; i++)
     {
         if (thread_table[i].state == T_SLEEPING)
         {
-            // If this tick is the thread's wakeup time
-            if (systime_ms == thread_table[i].scnt)
+            // If the thread's wakeup time has come
+            if (thread_table[i].wake <= now)
             {
                 // Wake it up
-                thread_table[i].state = T_RUNNABLE;
+                kernel_wake(&thread_table[i]);
+                trace_event(TRACE_WAKEUP, thread_table[i].id, 0);
             }
-            // If this is not the thread's wakeup time
-            // sort wakeup times to determine next runtime
-            else
+            // Otherwise, keep track of the earliest wakeup time
+            else if (thread_table[i].wake < next_wake)
             {
-                // Normalize the time (modulo UINT32_MAX + 1)
-                tsleep_t normtime = thread_table[i].scnt - systime_ms;
-                if(normtime < next_to_run_ms)
-                {
-                    next_to_run_ms = normtime;
-                }
+                next_wake = thread_table[i].wake;
             }
         }
     }
+}
+
+/**
+ * @brief Finishes a scheduler tick, after kernel_tick_counter(). The running
+ * thread carries on until its time slice is used up, unless a thread that
+ * should preempt it has woken up.
+ */
+__attribute__((noreturn))
+void kernel_tick_schedule(void)
+{
+    if(thread_current->slice)
+        thread_current->slice--;
+
+    // With preemption disabled, the switch waits for preempt_enable()
+    if(thread_current->state == T_RUNNABLE && thread_current->preempt_count)
+    {
+        if(!thread_current->slice)
+            kernel_need_resched = true;
+        kernel_run(thread_current);
+    }
+
+    if(thread_current->state == T_RUNNABLE && thread_current->slice &&
+       !kernel_need_resched)
+        kernel_run(thread_current);
+
+    kernel_schedule();
+}
+
+/**
+ * @brief Makes a blocked or sleeping thread runnable. Called from the kernel
+ * and from ISRs. If the scheduling policy says the thread should preempt the
+ * running one, the kernel switches to it: with KERNEL_WAKE_PREEMPT, when
+ * the current system call finishes, or, from an ISR, through
+ * kernel_preempt() once the ISR returns; otherwise at the next scheduler
+ * tick.
+ */
+void kernel_wake(thread_t* thread)
+{
+    thread->state = T_RUNNABLE;
+    sched_enqueue(thread);
+    if(sched_preempts(thread, thread_current))
+    {
+        kernel_need_resched = true;
+#if KERNEL_WAKE_PREEMPT
+        port_pend_switch();
+#endif
+    }
+}
+
+/**
+ * @brief Entered from kernel_entry through the switch exception (PendSV on
+ * Cortex-M) that kernel_wake() pends once the ISR that woke a thread has
+ * returned, and that preempt_enable() takes when a switch came due while
+ * preemption was disabled. Switches threads if one still should preempt
+ * thread_current; if a tick or system call got there first, this returns
+ * straight to thread_current.
+ */
+__attribute__((noreturn))
+void kernel_preempt(void)
+{
+    if(kernel_need_resched && !thread_current->preempt_count)
+    {
+        kernel_from_tick = true;
+        kernel_schedule();
+    }
+
+    kernel_run(thread_current);
+}
+
+/**
+ * @brief Signals an event, waking every thread blocked on it. Their
+ * sys_event_wait() calls return true.
+ *
+ * This is meant to be called from ISRs (and from the kernel). ISRs run at the
+ * same priority as the kernel's exceptions, so they never interrupt the
+ * kernel while it is using the thread table; zero-latency interrupts, above
+ * PORT_KERNEL_PRIORITY, must not call it. A thread that samples the event,
+ * checks its condition, and then calls sys_event_wait() with the sampled
+ * value cannot miss a signal that arrives in between: the counter will have
+ * moved, and the system call returns immediately.
+ *
+ * @param ev The event to signal.
+ */
+void kernel_event_signal(event_t* ev)
+{
+    int i;
+
+    (*ev)++;
+
+    for (i = 0; i < MAX_THREADS; i++)
+    {
+        if (((thread_table[i].state == T_BLOCKED) ||
+             (thread_table[i].state == T_SLEEPING)) &&
+            (thread_table[i].waitstat == WAITSTATUS_EVENT) &&
+            ((event_t*) thread_table[i].regs.R1 == ev))
+        {
+            // A timed waiter's wakeup tick stays in next_wake; the
+            // tick handler recomputes it when it finds nobody due.
+            thread_table[i].waitstat = WAITSTATUS_NONE;
+            thread_table[i].regs.R0 = true;
+            kernel_wake(&thread_table[i]);
+        }
+    }
+}
+
+/**
+ * @brief Returns the number of scheduler ticks since kernel_init(), as a
+ * 64-bit count that does not wrap in practice. Callable from threads and
+ * ISRs without a system call.
+ */
+uint64_t kernel_time_ticks(void)
+{
+    uint32_t hi, ticks;
+
+    // Reread if the tick carried into the high word in between
+    do
+    {
+        hi = dptr(&systime_hi);
+        ticks = dptr(&systime_ms);
+    } while(hi != dptr(&systime_hi));
+
+    return ((uint64_t) hi << 32) | ticks;
+}
 
-    // Denormalize (relative to current systime_ms)
-    next_to_run_ms += systime_ms;
+/**
+ * @brief Returns the number of CPU cycles since kernel_init(), as a 64-bit
+ * count with the resolution of the CPU clock (see port_time_cycles()).
+ * Callable from threads and ISRs without a system call.
+ */
+uint64_t kernel_time_cycles(void)
+{
+    return port_time_cycles();
+}
+
+/**
+ * @brief Returns the time since kernel_init() in nanoseconds, with the
+ * resolution of the CPU clock. Callable from threads and ISRs without a
+ * system call.
+ */
+uint64_t kernel_time_ns(void)
+{
+    uint64_t cycles = port_time_cycles();
+
+#if (F_CPU % 1000000) == 0
+    // Good for 2^64 / 1000 cycles, over seven years at 80 MHz
+    return cycles * 1000u / (F_CPU / 1000000);
+#else
+    return (cycles / F_CPU) * 1000000000u +
+           (cycles % F_CPU) * 1000000000u / F_CPU;
+#endif
 }
 
 /**
  * @brief Gets the system clock frequency.
  *
- * @return The system clock frequency, in Hertz.
+ * @return The system clock frequency, in Hertz. This is F_CPU, which is set
+ * per board by configure.py.
  */
 uint32_t kernel_get_system_freq(void)
 {
-    return 80000000ul;
+    return F_CPU;
 }
 
 /**
@@ -358,21 +882,7 @@ void kernel_set_scheduler_freq(uint32_t freq)
     return;
 #endif
 
-    // Set the SysTick current value register to 0.
-    dptr(0xE000E018) = 0;
-
-    /*
-     * Set the SysTick reload value to the system clock frequency divided by the
-     * desired frequency, minus 1. We subtract 1 because the cycles counted by
-     * the timer includes 0 and the reload value.
-     */
-    dptr(0xE000E014) = ((kernel_get_system_freq() / freq) - 1);
-
-    /*
-     * Set the SysTick source to the system clock, enable the interrupt, and
-     * start counting.
-     */
-    dptr(0xE000E010) |= 0x00000007;
+    port_tick_start(freq);
 }
 
 #ifdef __cplusplus
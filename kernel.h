@@ -12,12 +12,57 @@
 #include "syscall_numbers.h"
 
 #define KERNEL_PREEMPTION (1)
+// Record scheduler events into the trace ring (see trace.h)
+#ifndef KERNEL_TRACE
+#define KERNEL_TRACE (0)
+#endif
+// Sample the interrupted PC on every scheduler tick (see profile.h)
+#ifndef KERNEL_PROFILE
+#define KERNEL_PROFILE (0)
+#endif
+/*
+ * Share the CPU among best-effort threads of the same priority in proportion
+ * to their weights (see sys_set_weight()), rather than by taking turns
+ */
+#ifndef KERNEL_FAIR_SHARE
+#define KERNEL_FAIR_SHARE (0)
+#endif
+/*
+ * Scheduling policy, fixed when the kernel is built (see sched.h): plain
+ * round robin, fixed priority, or fixed priority with an
+ * earliest-deadline-first class ahead of it
+ */
+#define SCHED_POLICY_RR (0)
+#define SCHED_POLICY_PRIO (1)
+#define SCHED_POLICY_EDF (2)
+#ifndef KERNEL_SCHED_POLICY
+#define KERNEL_SCHED_POLICY SCHED_POLICY_EDF
+#endif
+/*
+ * Switch to a woken thread that should preempt the running one (see
+ * sched_preempts()) as soon as the ISR or system call that woke it returns,
+ * rather than at the next scheduler tick
+ */
+#ifndef KERNEL_WAKE_PREEMPT
+#define KERNEL_WAKE_PREEMPT (1)
+#endif
 #define KERNEL_SCHEDULER_IRQ_FREQ (1000)
 #define SYSTIME_CYCLES_PER_MS (1000/KERNEL_SCHEDULER_IRQ_FREQ)
+#ifndef KERNEL_STACKSIZE
 #define KERNEL_STACKSIZE (1024)
+#endif
 
 extern uint8_t kernel_stack[KERNEL_STACKSIZE] __attribute((aligned(8)));
 
 void kernel_init(void* current_stack_top);
+uint32_t kernel_get_system_freq(void);
+void kernel_event_signal(event_t* ev);
+void kernel_wake(thread_t* thread);
+
+// Set when a woken thread should preempt the running one; see kernel.c
+extern volatile bool kernel_need_resched;
+uint64_t kernel_time_ticks(void);
+uint64_t kernel_time_cycles(void);
+uint64_t kernel_time_ns(void);
 
 #endif /* KERNEL_H_ */
@@ -0,0 +1,143 @@
+/**
+ * @brief Tokenized deferred logging; see log.h.
+ */
+
+#include "log.h"
+#include "port.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_RING_MASK (LOG_RING_WORDS - 1)
+
+#if (LOG_RING_WORDS & LOG_RING_MASK) != 0
+#error "LOG_RING_WORDS must be a power of two"
+#endif
+
+/*
+ * One ring per thread table slot. head and tail count words; head and
+ * dropped are only written by the thread in the slot, tail only by the
+ * drain thread.
+ */
+typedef struct
+{
+    uint32_t buf[LOG_RING_WORDS];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+} log_ring_t;
+
+static log_ring_t log_rings[MAX_THREADS];
+
+static Serial_module_e log_module;
+
+/**
+ * @brief Appends a record to the calling thread's ring. Use LOG() rather than
+ * calling this directly.
+ */
+void log_write(uint32_t token, const uint32_t* args, uint32_t nargs)
+{
+    thread_t* self = thread_current;
+    log_ring_t* ring;
+    uint32_t head, i;
+
+    if(!self)
+        return;
+
+    ring = &log_rings[self - thread_table];
+    head = ring->head;
+
+    if(LOG_RING_WORDS - (head - ring->tail) < nargs + 3)
+    {
+        ring->dropped++;
+        return;
+    }
+
+    ring->buf[head++ & LOG_RING_MASK] = LOG_SYNC | (nargs << 8) |
+                                        (self->id << 16);
+    ring->buf[head++ & LOG_RING_MASK] = token;
+    ring->buf[head++ & LOG_RING_MASK] = port_cycles();
+    for(i = 0; i < nargs; i++)
+        ring->buf[head++ & LOG_RING_MASK] = args[i];
+
+    // The record must be complete before the drain thread can see it
+    asm volatile("" : : : "memory");
+    ring->head = head;
+}
+
+/*
+ * Sends the words in ring positions [from, to).
+ */
+static void log_send(log_ring_t* ring, uint32_t from, uint32_t to)
+{
+    uint32_t start = from & LOG_RING_MASK;
+    uint32_t count = to - from;
+    uint32_t first = LOG_RING_WORDS - start;
+
+    if(count <= first)
+    {
+        Serial_writebuf(log_module, (const uint8_t*) &ring->buf[start],
+                        count * sizeof(uint32_t));
+    }
+    else
+    {
+        Serial_writebuf(log_module, (const uint8_t*) &ring->buf[start],
+                        first * sizeof(uint32_t));
+        Serial_writebuf(log_module, (const uint8_t*) ring->buf,
+                        (count - first) * sizeof(uint32_t));
+    }
+}
+
+static int log_drain_main(void* arg)
+{
+    static uint32_t reported[MAX_THREADS];
+    uint32_t i, head, dropped, note[2];
+    log_ring_t* ring;
+
+    (void) arg;
+
+    while(1)
+    {
+        for(i = 0; i < MAX_THREADS; i++)
+        {
+            ring = &log_rings[i];
+
+            head = ring->head;
+            if(head != ring->tail)
+            {
+                log_send(ring, ring->tail, head);
+                ring->tail = head;
+            }
+
+            dropped = ring->dropped;
+            if(dropped != reported[i])
+            {
+                note[0] = LOG_SYNC_DROPPED | (thread_table[i].id << 16);
+                note[1] = dropped - reported[i];
+                Serial_writebuf(log_module, (const uint8_t*) note,
+                                sizeof(note));
+                reported[i] = dropped;
+            }
+        }
+
+        sys_sleep(LOG_DRAIN_MS);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Spawns the drain thread, which sends logged records to module
+ * every LOG_DRAIN_MS. The drain thread assumes it is the only writer on
+ * module; other output on the same port must not interleave with it, since
+ * that would split records (the decoder resynchronizes, but loses them).
+ *
+ * @return The drain thread's tid, or 0 if no thread slot was free.
+ */
+tid_t log_start(Serial_module_e module)
+{
+    log_module = module;
+    return sys_spawn(log_drain_main, NULL);
+}
@@ -0,0 +1,76 @@
+/*
+ * log.h
+ *
+ * Tokenized deferred logging. LOG("fmt", args...) does no formatting: it
+ * copies a token for the format string, a timestamp and the raw arguments
+ * into the calling thread's own log ring and returns. A drain thread started
+ * by log_start() ships the records over a serial port, and
+ * tools/log_decode.py formats them on the host, reading the format strings
+ * back out of main.elf.
+ *
+ * The format strings live in the .logstr section, which the board linker
+ * scripts keep in the ELF but never load, so they cost no flash. A string's
+ * token is its address, i.e. its offset in .logstr.
+ *
+ * Each thread table slot has its own single-producer ring, so LOG() takes no
+ * lock and never blocks; if the ring is full, the record is dropped and
+ * counted, and the drop is reported in the log. LOG() may only be called
+ * from threads (not ISRs, which would share the interrupted thread's ring),
+ * and does nothing before kernel_init().
+ *
+ * Arguments are 32-bit integers, up to LOG_MAX_ARGS of them; the decoder
+ * understands %d %i %u %x %X %o %c %p and %% with the usual flags and widths.
+ * There is no %s or %f: log integers, or fixed-point values.
+ *
+ * Stream format, one record after another (32-bit little-endian words):
+ *      word 0  LOG_SYNC | nargs << 8 | tid << 16
+ *      word 1  format string token
+ *      word 2  timestamp, port_cycles()
+ *      word 3+ nargs arguments
+ * or, after records were dropped:
+ *      word 0  LOG_SYNC_DROPPED | tid << 16
+ *      word 1  number of records dropped since the last report
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include "drivers/driver_serial.h"
+#include "thread.h"
+
+#include <stdint.h>
+
+#ifndef LOG_RING_WORDS
+#define LOG_RING_WORDS (64) // per thread; must be a power of two
+#endif
+
+// How often the drain thread looks for new records
+#ifndef LOG_DRAIN_MS
+#define LOG_DRAIN_MS (10)
+#endif
+
+#define LOG_MAX_ARGS (8)
+
+#define LOG_SYNC (0xA5)
+#define LOG_SYNC_DROPPED (0xA6)
+
+/**
+ * @brief Logs a message. fmt must be a string literal.
+ */
+#define LOG(fmt, ...)                                                          \
+    do                                                                         \
+    {                                                                          \
+        static const char log_fmt_[]                                           \
+            __attribute__((section(".logstr"))) = fmt;                         \
+        const uint32_t log_args_[] = { 0, ##__VA_ARGS__ };                     \
+        _Static_assert(sizeof(log_args_) <=                                    \
+                       (LOG_MAX_ARGS + 1) * sizeof(uint32_t),                  \
+                       "too many LOG() arguments");                            \
+        log_write((uint32_t)(uintptr_t) log_fmt_, &log_args_[1],               \
+                  sizeof(log_args_) / sizeof(uint32_t) - 1);                   \
+    } while(0)
+
+void log_write(uint32_t token, const uint32_t* args, uint32_t nargs);
+tid_t log_start(Serial_module_e module);
+
+#endif /* LOG_H_ */
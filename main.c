@@ -1,4 +1,4 @@
-#include "driverlib/sysctl.h"
+#include "board.h"
 #include "drivers/driver_serial.h"
 #include "kernel.h"
 #include "syscalls.h"
@@ -30,8 +30,7 @@ int worker2_main(void* arg)
 
 int main(void)
 {
-    SysCtlClockSet(SYSCTL_SYSDIV_2_5 | SYSCTL_USE_PLL | SYSCTL_XTAL_16MHZ
-                   | SYSCTL_OSC_MAIN);
+    board_init();
 
     Serial_init(Serial_module_debug, 115200);
 
@@ -0,0 +1,140 @@
+/**
+ * @brief Fixed-block memory pools; see mempool.h.
+ */
+
+#include "mempool.h"
+#include "port.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A free block holds the address of the next one
+typedef struct mempool_block
+{
+    struct mempool_block* next;
+} mempool_block_t;
+
+/**
+ * @brief Sets up a pool over caller-provided storage, which must be 8-byte
+ * aligned and hold count blocks of MEMPOOL_BLOCK_SIZE(block_size) bytes. For
+ * pools whose size is only known at run time; MEMPOOL_DEFINE() needs no
+ * initialization.
+ */
+void mempool_init(mempool_t* pool, void* storage, uint32_t block_size,
+                  uint32_t count)
+{
+    pool->free = 0;
+    pool->carved = 0;
+    pool->storage = (uint8_t*) storage;
+    pool->block_size = MEMPOOL_BLOCK_SIZE(block_size);
+    pool->count = count;
+    pool->in_use = 0;
+    pool->peak = 0;
+    pool->allocs = 0;
+    pool->failures = 0;
+}
+
+/*
+ * Pops the free list. Reading head->next is safe even if another context
+ * takes head first, since the store then fails and the value is discarded.
+ */
+static void* mempool_pop(mempool_t* pool)
+{
+    uintptr_t head;
+
+    do
+    {
+        head = port_load_exclusive(&pool->free);
+        if(!head)
+        {
+            port_clear_exclusive();
+            return NULL;
+        }
+    } while(!port_store_exclusive(&pool->free,
+                                  (uintptr_t)((mempool_block_t*) head)->next));
+
+    return (void*) head;
+}
+
+/*
+ * Carves the next never-used block off the storage.
+ */
+static void* mempool_carve(mempool_t* pool)
+{
+    uintptr_t index;
+
+    do
+    {
+        index = port_load_exclusive(&pool->carved);
+        if(index == pool->count)
+        {
+            port_clear_exclusive();
+            return NULL;
+        }
+    } while(!port_store_exclusive(&pool->carved, index + 1));
+
+    return pool->storage + index * pool->block_size;
+}
+
+/**
+ * @brief Takes a block from the pool. Callable from threads and ISRs.
+ *
+ * @return The block, or NULL if the pool is empty.
+ */
+void* mempool_alloc(mempool_t* pool)
+{
+    void* block;
+    uint32_t in_use, peak;
+
+    block = mempool_pop(pool);
+    if(!block)
+        block = mempool_carve(pool);
+
+    if(!block)
+    {
+        __atomic_fetch_add(&pool->failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    __atomic_fetch_add(&pool->allocs, 1, __ATOMIC_RELAXED);
+    in_use = __atomic_add_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+
+    peak = pool->peak;
+    while(in_use > peak &&
+          !__atomic_compare_exchange_n(&pool->peak, &peak, in_use, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    return block;
+}
+
+/**
+ * @brief Returns a block to the pool it came from. Callable from threads and
+ * ISRs. block must have come from mempool_alloc() on the same pool.
+ */
+void mempool_free(mempool_t* pool, void* block)
+{
+    mempool_block_t* b = (mempool_block_t*) block;
+    uintptr_t head;
+
+    do
+    {
+        head = port_load_exclusive(&pool->free);
+        b->next = (mempool_block_t*) head;
+    } while(!port_store_exclusive(&pool->free, (uintptr_t) b));
+
+    __atomic_fetch_sub(&pool->in_use, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Returns true if block is one of pool's blocks, e.g. to find which
+ * pool to free a block to.
+ */
+bool mempool_owns(const mempool_t* pool, const void* block)
+{
+    const uint8_t* p = (const uint8_t*) block;
+
+    return p >= pool->storage &&
+           p < pool->storage + pool->count * pool->block_size &&
+           (size_t)(p - pool->storage) % pool->block_size == 0;
+}
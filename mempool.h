@@ -0,0 +1,77 @@
+/*
+ * mempool.h
+ *
+ * Fixed-block memory pools. A pool hands out blocks of one size from static
+ * storage, in constant time, from threads and ISRs alike, and never
+ * fragments:
+ *
+ *     MEMPOOL_DEFINE(packet_pool, sizeof(packet_t), 16);
+ *
+ *     packet_t* p = mempool_alloc(&packet_pool);
+ *     ...
+ *     mempool_free(&packet_pool, p);
+ *
+ * MEMPOOL_DEFINE() lays the pool out at compile time, so there is nothing to
+ * initialize at startup. Blocks that have never been handed out are carved
+ * off the end of the storage in order; freed blocks go on a free list, which
+ * is taken first. Both are updated with port_load_exclusive() and
+ * port_store_exclusive() (LDREX/STREX on Cortex-M), retrying if an
+ * interrupt or context switch got in between, so neither allocating nor
+ * freeing ever masks interrupts or takes a lock.
+ *
+ * Each pool keeps usage statistics: blocks in use and the most ever in use at
+ * once, and counts of allocations and of failures because the pool was
+ * empty. mempool_alloc() returns NULL rather than waiting for a block.
+ */
+
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Block size actually used for size-byte blocks: big enough for a free list
+// link, and a multiple of 8 so that every block is 8-byte aligned
+#define MEMPOOL_BLOCK_SIZE(size)                                               \
+    ((((size) < sizeof(void*) ? sizeof(void*) : (size)) + 7) & ~(size_t) 7)
+
+/**
+ * @brief Defines a pool called name of n blocks of at least size bytes,
+ * with its storage. Use at file scope.
+ */
+#define MEMPOOL_DEFINE(name, size, n)                                          \
+    static uint8_t name##_storage_[(n) * MEMPOOL_BLOCK_SIZE(size)]             \
+        __attribute__((aligned(8)));                                           \
+    mempool_t name = {                                                         \
+        .storage = name##_storage_,                                            \
+        .block_size = MEMPOOL_BLOCK_SIZE(size),                                \
+        .count = (n),                                                          \
+    }
+
+// Type for a fixed-block pool. Treat the statistics as read-only.
+typedef struct
+{
+    // Free list head, a block address, or 0 if the list is empty
+    volatile uintptr_t free;
+    // Number of blocks carved off the storage so far
+    volatile uintptr_t carved;
+
+    uint8_t* storage;
+    uint32_t block_size;
+    uint32_t count;
+
+    // Statistics
+    volatile uint32_t in_use;
+    volatile uint32_t peak;
+    volatile uint32_t allocs;
+    volatile uint32_t failures;
+} mempool_t;
+
+void mempool_init(mempool_t* pool, void* storage, uint32_t block_size,
+                  uint32_t count);
+void* mempool_alloc(mempool_t* pool);
+void mempool_free(mempool_t* pool, void* block);
+bool mempool_owns(const mempool_t* pool, const void* block);
+
+#endif /* MEMPOOL_H_ */
@@ -0,0 +1,35 @@
+/**
+ * @brief Drift-free periodic release helper; see periodic.h.
+ */
+
+#include "periodic.h"
+#include "syscalls.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Starts a schedule whose first release is one period from now.
+ */
+void periodic_init(periodic_t* p, uint32_t period_ms)
+{
+    p->period = period_ms;
+    p->next = sys_time();
+    p->overruns = 0;
+}
+
+/**
+ * @brief Sleeps until the next release time.
+ */
+void periodic_wait(periodic_t* p)
+{
+    uint32_t late;
+
+    p->next += p->period;
+    late = sys_sleep_until(p->next);
+
+    if(late >= p->period)
+    {
+        p->overruns += late / p->period;
+        p->next += (late / p->period) * p->period;
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * periodic.h
+ *
+ * Drift-free periodic loops. A loop that calls sys_sleep(period) releases
+ * late by its own execution time plus its scheduling delay every period, and
+ * the error accumulates. periodic_wait() instead sleeps until the next
+ * absolute release time, which advances by exactly one period each call:
+ *
+ *     periodic_t p;
+ *
+ *     periodic_init(&p, 10);
+ *     while(1)
+ *     {
+ *         periodic_wait(&p);
+ *         ...
+ *     }
+ *
+ * If the loop body overruns by a whole period or more, the missed releases
+ * are skipped (and counted) rather than run back to back.
+ */
+
+#ifndef PERIODIC_H_
+#define PERIODIC_H_
+
+#include <stdint.h>
+
+// Type for a periodic release schedule
+typedef struct
+{
+    // Next release time, in sys_time() milliseconds
+    uint32_t next;
+    uint32_t period;
+    // Releases skipped because the loop ran late
+    uint32_t overruns;
+} periodic_t;
+
+void periodic_init(periodic_t* p, uint32_t period_ms);
+void periodic_wait(periodic_t* p);
+
+#endif /* PERIODIC_H_ */
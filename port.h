@@ -0,0 +1,386 @@
+/*
+ * port.h
+ *
+ * CPU port layer. These are the only pieces of the kernel that depend on the
+ * processor it runs on. The Cortex-M implementation lives in port/cortex_m
+ * (together with kernel_asm.S) and is shared by every board under boards/;
+ * port/host implements the same interface on top of ucontext and POSIX
+ * signals so that the kernel can run as a Linux process.
+ *
+ * Bracketed references refer to the ARMv7-M Architecture Reference Manual:
+ *
+ * [ARM: X] => ARMv7-M ARM section X
+ *
+ * On both ports, kernel_entry() saves thread_current's context and calls into
+ * the kernel on the kernel stack, and kernel_exit() resumes thread_current.
+ */
+
+#ifndef PORT_H_
+#define PORT_H_
+
+#include "os_utils.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * The scheduler tick count, maintained by kernel_tick_counter(). systime_ms
+ * is the low word and systime_hi the high word of a 64-bit count; the tick
+ * advances systime_ms first and systime_hi after it wraps.
+ */
+extern uint32_t systime_ms;
+extern uint32_t systime_hi;
+
+#ifdef PORT_HOST
+
+#include <time.h>
+
+/*
+ * The caller of kernel_init() keeps running on the process stack; there is
+ * nothing to relocate.
+ */
+#define PORT_ADOPT_STACK(current_stack_top, new_stack_top) \
+    do { (void)(current_stack_top); (void)(new_stack_top); } while(0)
+
+/**
+ * @brief Returns a free-running 32-bit cycle counter. The host port runs with
+ * F_CPU at 1 GHz, so a cycle is a nanosecond of CLOCK_MONOTONIC.
+ */
+static inline uint32_t port_cycles(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+
+/**
+ * @brief Returns true when called from an exception handler. The host port
+ * has no interrupt handlers outside the kernel, so this is always false.
+ */
+static inline bool port_in_isr(void)
+{
+    return false;
+}
+
+// CLOCK_MONOTONIC at port_tick_start(), in nanoseconds
+extern uint64_t port_time_base;
+
+/**
+ * @brief Returns a 64-bit cycle count since the scheduler tick was started.
+ * There is no SysTick counter to read, so the host port reads
+ * CLOCK_MONOTONIC directly. It keeps real time even when the process loses
+ * SIGALRM ticks under load, so it can run ahead of the tick count.
+ */
+static inline uint64_t port_time_cycles(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec - port_time_base;
+}
+
+/**
+ * @brief Exclusive access, emulating LDREX/STREX (see the Cortex-M version).
+ * The host port has a single emulated monitor: port_load_exclusive() opens
+ * it, and the tick, kernel entry and the board's signal handlers clear it,
+ * as exception entry does on the target. port_store_exclusive() masks
+ * signals while it checks the monitor and stores, so it costs two system
+ * calls.
+ */
+uintptr_t port_load_exclusive(volatile uintptr_t* addr);
+bool port_store_exclusive(volatile uintptr_t* addr, uintptr_t value);
+void port_clear_exclusive(void);
+
+// Set by port_pend_switch(); see port_isr_exit() in port_host.h
+extern volatile bool port_switch_pending;
+
+/**
+ * @brief Requests a pass through kernel_preempt() once no handler is running
+ * (see the Cortex-M version). The board's signal handlers, which stand in
+ * for interrupts, make it on their way out.
+ */
+static inline void port_pend_switch(void)
+{
+    port_switch_pending = true;
+}
+
+/**
+ * @brief Withdraws a request made by port_pend_switch().
+ */
+static inline void port_cancel_switch(void)
+{
+    port_switch_pending = false;
+}
+
+/**
+ * @brief Interrupt masking and thread-mode preemption (see the Cortex-M
+ * versions). Masking blocks every signal but PORT_ZERO_LATENCY_SIGNAL (see
+ * port_host.h); the mask nests, and the value returned is only meaningful
+ * to port_irq_restore().
+ */
+uint32_t port_irq_mask(void);
+void port_irq_restore(uint32_t old);
+void port_preempt(void);
+
+#else
+
+/*
+ * Relocate the caller's stack into the thread 0 stack slot. The caller
+ * should not have created any pointers into their stack, otherwise this
+ * will result in catastrophe. This must be expanded inline in the function
+ * whose stack is being moved.
+ */
+#define PORT_ADOPT_STACK(current_stack_top, new_stack_top)                     \
+    asm volatile(                                                              \
+        "mov r3,%0\r\n"                                                        \
+        "mov r0,%1\r\n"                                                        \
+        "mov r1,sp\r\n"                                                        \
+        "sub r2,r3,r1\r\n"                                                     \
+        "sub r0,r2\r\n"                                                        \
+        "push {r0}\r\n"                                                        \
+        "bl memcpy\r\n"                                                        \
+        "pop {r0}\r\n"                                                         \
+        "dsb\r\n"                                                              \
+        "isb\r\n"                                                              \
+        "mov sp,r0\r\n"                                                        \
+     : : "r" (current_stack_top), "r" (new_stack_top) :                        \
+     "memory", "0", "1", "2", "3" )
+
+/*
+ * The kernel's priority ceiling [ARM: B1.5.4]: the priority of the kernel's
+ * exceptions (SVCall, PendSV and SysTick) and of every ISR that calls into
+ * the kernel, which port_irq_init() gives every interrupt. The kernel never
+ * masks anything above it, so an interrupt moved to a higher priority (a
+ * lower number) with port_irq_set_priority() is a zero-latency interrupt:
+ * it preempts the kernel and critical_enter() sections alike, and in return
+ * must not call into the kernel. Only the top three bits are used, since
+ * that is all the TM4C123 implements; the default leaves the other seven
+ * levels above the kernel.
+ */
+#ifndef PORT_KERNEL_PRIORITY
+#define PORT_KERNEL_PRIORITY (0xE0)
+#endif
+
+#if PORT_KERNEL_PRIORITY == 0 || (PORT_KERNEL_PRIORITY & 0x1F) != 0 ||         \
+    PORT_KERNEL_PRIORITY > 0xE0
+#error "PORT_KERNEL_PRIORITY must be one of 0x20, 0x40, ... 0xE0"
+#endif
+
+// SysTick and interrupt control registers [ARM: B3.3, B3.2.4]
+#define PORT_SYST_RVR       (0xE000E014)
+#define PORT_SYST_CVR       (0xE000E018)
+#define PORT_ICSR           (0xE000ED04)
+#define PORT_ICSR_PENDST    (0x04000000)
+#define PORT_ICSR_PENDSVCLR (0x08000000)
+#define PORT_ICSR_PENDSVSET (0x10000000)
+
+/**
+ * @brief Returns a free-running 32-bit cycle counter, built from the number of
+ * scheduler ticks and the cycles elapsed in the current one. This is used
+ * instead of DWT CYCCNT because QEMU does not model the DWT.
+ *
+ * Safe to call from threads, ISRs and the kernel. A tick that has wrapped the
+ * SysTick counter but is still pending (because the caller is masking it) is
+ * accounted for.
+ */
+static inline uint32_t port_cycles(void)
+{
+    uint32_t ticks, val, reload;
+
+    do
+    {
+        ticks = dptr(&systime_ms);
+        val = dptr(PORT_SYST_CVR);
+    } while(ticks != dptr(&systime_ms));
+
+    reload = dptr(PORT_SYST_RVR);
+
+    if((dptr(PORT_ICSR) & PORT_ICSR_PENDST) && val > (reload >> 1))
+        ticks++;
+
+    return ticks * (reload + 1) + (reload - val);
+}
+
+/**
+ * @brief Returns true when called from an exception handler, i.e. when the
+ * IPSR holds a nonzero exception number [ARM: B1.4.2]. Threads can block in
+ * system calls; handlers cannot.
+ */
+static inline bool port_in_isr(void)
+{
+    uint32_t ipsr;
+
+    asm volatile("mrs %0, ipsr" : "=r" (ipsr));
+    return (ipsr & 0x1FF) != 0;
+}
+
+/**
+ * @brief Returns a 64-bit cycle count since the scheduler tick was started:
+ * the 64-bit tick count times the tick length, plus the cycles elapsed in the
+ * current tick, read from the SysTick current value register.
+ *
+ * Safe to call from threads, ISRs and the kernel, with the same pending-tick
+ * handling as port_cycles(). The words are reread until neither changed, so a
+ * tick that lands in the middle is not torn; the one exception is an ISR
+ * that preempts the SysTick handler itself, which can see the low word
+ * wrapped before the high word is advanced (once every 49 days).
+ */
+static inline uint64_t port_time_cycles(void)
+{
+    uint32_t hi, ticks, val, reload;
+    uint64_t now;
+
+    do
+    {
+        hi = dptr(&systime_hi);
+        ticks = dptr(&systime_ms);
+        val = dptr(PORT_SYST_CVR);
+    } while(hi != dptr(&systime_hi) || ticks != dptr(&systime_ms));
+
+    reload = dptr(PORT_SYST_RVR);
+    now = ((uint64_t) hi << 32) | ticks;
+
+    if((dptr(PORT_ICSR) & PORT_ICSR_PENDST) && val > (reload >> 1))
+        now++;
+
+    return now * (reload + 1) + (reload - val);
+}
+
+/**
+ * @brief Loads *addr and marks it for exclusive access [ARM: A3.4]. A
+ * following port_store_exclusive() only succeeds if nothing has broken the
+ * reservation in between; exception entry and return do, so on a single
+ * core this detects any interrupt or context switch that might have changed
+ * *addr. Every load must be followed by a store or port_clear_exclusive().
+ */
+static inline uintptr_t port_load_exclusive(volatile uintptr_t* addr)
+{
+    uintptr_t value;
+
+    asm volatile("ldrex %0, [%1]" : "=r" (value) : "r" (addr) : "memory");
+    return value;
+}
+
+/**
+ * @brief Stores value to *addr if the reservation made by
+ * port_load_exclusive() still holds.
+ *
+ * @return true if the store happened; otherwise retry from the load.
+ */
+static inline bool port_store_exclusive(volatile uintptr_t* addr,
+                                        uintptr_t value)
+{
+    uint32_t failed;
+
+    asm volatile("strex %0, %2, [%1]"
+                 : "=&r" (failed) : "r" (addr), "r" (value) : "memory");
+    return !failed;
+}
+
+/**
+ * @brief Abandons a reservation made by port_load_exclusive().
+ */
+static inline void port_clear_exclusive(void)
+{
+    asm volatile("clrex" : : : "memory");
+}
+
+/**
+ * @brief Pends PendSV [ARM: B1.5.2], which enters kernel_entry and
+ * kernel_preempt(). PendSV has the same priority as the kernel's other
+ * exceptions and the ISRs that call into it, so it is taken when the last of
+ * them returns, tail-chained onto it, and never interrupts the kernel.
+ */
+static inline void port_pend_switch(void)
+{
+    dptr(PORT_ICSR) = PORT_ICSR_PENDSVSET;
+}
+
+/**
+ * @brief Clears a pending PendSV, once the kernel has made the switch that
+ * it was pended for on its own.
+ */
+static inline void port_cancel_switch(void)
+{
+    dptr(PORT_ICSR) = PORT_ICSR_PENDSVCLR;
+}
+
+/**
+ * @brief Masks the interrupts of PORT_KERNEL_PRIORITY by raising BASEPRI
+ * [ARM: B1.4.3], with BASEPRI_MAX so that it never lowers a mask already in
+ * place. Higher-priority exceptions are not affected.
+ *
+ * @return The previous BASEPRI, for port_irq_restore().
+ */
+static inline uint32_t port_irq_mask(void)
+{
+    uint32_t old;
+
+    asm volatile("mrs %0, basepri\r\n"
+                 "msr basepri_max, %1"
+                 : "=&r" (old) : "r" (PORT_KERNEL_PRIORITY) : "memory");
+    return old;
+}
+
+/**
+ * @brief Puts back the BASEPRI returned by port_irq_mask().
+ */
+static inline void port_irq_restore(uint32_t old)
+{
+    asm volatile("msr basepri, %0" : : "r" (old) : "memory");
+}
+
+/**
+ * @brief From thread mode, enters kernel_preempt() straight away: PendSV is
+ * taken as soon as it is pended, unless interrupts are masked, in which case
+ * it is taken when they are unmasked.
+ */
+static inline void port_preempt(void)
+{
+    port_pend_switch();
+    asm volatile("dsb\r\n"
+                 "isb" : : : "memory");
+}
+
+#endif
+
+/**
+ * @brief Starts the periodic scheduler interrupt, which enters the kernel
+ * through kernel_tick_counter() and kernel_schedule().
+ *
+ * @param freq The desired interrupt frequency, in Hertz.
+ */
+void port_tick_start(uint32_t freq);
+
+/**
+ * @brief Gives the kernel's exceptions and every interrupt the same priority,
+ * PORT_KERNEL_PRIORITY on Cortex-M, so that ISRs never interrupt the kernel
+ * and port_irq_mask() masks all of them. Called from kernel_init().
+ */
+void port_irq_init(void);
+
+/**
+ * @brief Sets the priority of external interrupt irq, on Cortex-M, after
+ * port_irq_init(). ISRs that call into the kernel must stay at
+ * PORT_KERNEL_PRIORITY; see there for the higher ones. The host port has no
+ * interrupt priorities: its boards pick a signal that the kernel masks or
+ * one that it does not (see PORT_ZERO_LATENCY_SIGNAL).
+ */
+void port_irq_set_priority(uint32_t irq, uint32_t priority);
+
+/**
+ * @brief Resets the system. Does not return.
+ */
+__attribute__((noreturn))
+void port_reset(void);
+
+/**
+ * @brief Stops the system after a kernel panic. On hardware this masks
+ * interrupts and spins so that a debugger can inspect the state; on the host
+ * it aborts the process.
+ */
+__attribute__((noreturn))
+void port_halt(void);
+
+#endif /* PORT_H_ */
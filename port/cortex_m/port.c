@@ -0,0 +1,76 @@
+/**
+ * @brief Cortex-M4 implementation of the port layer (see port.h). The kernel
+ * entry and exit routines themselves are in kernel_asm.S.
+ *
+ * Bracketed references refer to the ARMv7-M Architecture Reference Manual:
+ *
+ * [ARM: X] => ARMv7-M ARM section X
+ */
+
+#include "port.h"
+#include "kernel.h"
+#include "os_utils.h"
+
+#include <stdint.h>
+
+#define dptr8(_x_) (*((volatile uint8_t*)(_x_)))
+
+void port_tick_start(uint32_t freq)
+{
+    // Set the SysTick current value register to 0.
+    dptr(0xE000E018) = 0;
+
+    /*
+     * Set the SysTick reload value to the system clock frequency divided by the
+     * desired frequency, minus 1. We subtract 1 because the cycles counted by
+     * the timer includes 0 and the reload value.
+     */
+    dptr(0xE000E014) = ((kernel_get_system_freq() / freq) - 1);
+
+    /*
+     * Set the SysTick source to the system clock, enable the interrupt, and
+     * start counting.
+     */
+    dptr(0xE000E010) |= 0x00000007;
+}
+
+void port_irq_init(void)
+{
+    uint32_t i, lines;
+
+    // SVCall, PendSV and SysTick, in SHPR2 and SHPR3 [ARM: B3.2.11]
+    dptr8(0xE000ED1F) = PORT_KERNEL_PRIORITY;
+    dptr8(0xE000ED22) = PORT_KERNEL_PRIORITY;
+    dptr8(0xE000ED23) = PORT_KERNEL_PRIORITY;
+
+    // Every external interrupt the NVIC implements, 32 per ICTR.INTLINESNUM
+    // [ARM: B3.4.3, B3.4.4]
+    lines = ((dptr(0xE000E004) & 0xF) + 1) * 32;
+    for(i = 0; i < lines; i++)
+        dptr8(0xE000E400 + i) = PORT_KERNEL_PRIORITY;
+}
+
+void port_irq_set_priority(uint32_t irq, uint32_t priority)
+{
+    dptr8(0xE000E400 + irq) = priority;
+}
+
+void port_reset(void)
+{
+    // Request a system reset through AIRCR [ARM: B3.2.6]
+    dptr(0xE000ED0C) = 0x05FA0004;
+
+    while(1)
+        ;
+}
+
+void port_halt(void)
+{
+    // Disable interrupts
+    asm volatile("cpsid i" : : : "memory");
+
+    while(1)
+    {
+        ;
+    }
+}
@@ -0,0 +1,313 @@
+/**
+ * @brief Host counterpart of kernel_asm.S: kernel entry and exit, and the
+ * system call stubs, implemented with ucontext.
+ *
+ * Each thread table slot has a ucontext_t that holds the thread's saved
+ * context while it is not running. Entering the kernel saves the running
+ * thread into its slot and switches to a fresh context on kernel_stack, which
+ * then calls kernel_tick_counter()/kernel_tick_schedule(), kernel_preempt()
+ * or kernel_handle_syscall(), exactly as kernel_entry does on the target. The
+ * kernel always leaves through kernel_exit(), which resumes thread_current.
+ *
+ * The scheduler tick is SIGALRM (see port.c). It is blocked for the whole
+ * time the kernel runs, as is every other signal but
+ * PORT_ZERO_LATENCY_SIGNAL, so, as on the target, only a zero-latency
+ * interrupt ever preempts the kernel.
+ *
+ * Threads are started from regs.PC and regs.R0 the first time they are run.
+ * After that, regs.PC only records where the thread was last interrupted by
+ * the tick (for the profiler); system calls clear it. System call arguments
+ * and return values travel through regs.R0-R3, as they do on the target.
+ */
+
+#define _GNU_SOURCE
+
+#include "kernel.h"
+#include "port.h"
+#include "port_host.h"
+#include "syscalls.h"
+#include "thread.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <ucontext.h>
+
+extern void kernel_tick_counter(void);
+extern void kernel_tick_schedule(void);
+extern void kernel_preempt(void);
+extern void kernel_handle_syscall(void);
+extern void kernel_panic(void);
+
+/*
+ * Saved contexts, one per thread table slot, and the tid of the thread that
+ * each one belongs to. A slot whose tid does not match the thread occupying
+ * it holds a thread that has never run.
+ */
+static ucontext_t port_thread_ctx[MAX_THREADS];
+static tid_t port_thread_ctx_tid[MAX_THREADS];
+
+static ucontext_t port_kernel_ctx;
+static ucontext_t port_ctx_template;
+static bool port_ctx_template_valid;
+
+// Which exception entered the kernel
+static volatile int port_exception;
+
+static const ucontext_t* port_template(void)
+{
+    if(!port_ctx_template_valid)
+    {
+        getcontext(&port_ctx_template);
+        port_ctx_template_valid = true;
+    }
+    return &port_ctx_template;
+}
+
+/*
+ * The kernel_entry dispatch: tick, PendSV or system call.
+ */
+static void port_kernel_main(void)
+{
+    if(port_exception == PORT_EXCEPTION_TICK)
+    {
+        kernel_tick_counter();
+        kernel_tick_schedule();
+    }
+
+    if(port_exception == PORT_EXCEPTION_PENDSV)
+        kernel_preempt();
+
+    kernel_handle_syscall();
+}
+
+void port_kernel_entry(int exception)
+{
+    uint32_t pos = thread_pos(thread_current);
+
+    port_exception = exception;
+    port_clear_exclusive();
+    port_thread_ctx_tid[pos] = thread_current->id;
+
+    memcpy(&port_kernel_ctx, port_template(), sizeof(ucontext_t));
+    port_kernel_ctx.uc_stack.ss_sp = kernel_stack;
+    port_kernel_ctx.uc_stack.ss_size = KERNEL_STACKSIZE;
+    port_kernel_ctx.uc_link = NULL;
+    port_kernel_sigmask(&port_kernel_ctx.uc_sigmask);
+    makecontext(&port_kernel_ctx, port_kernel_main, 0);
+
+    swapcontext(&port_thread_ctx[pos], &port_kernel_ctx);
+}
+
+/*
+ * First code run by every spawned thread. kernel_exit() starts it with the
+ * kernel's signals still blocked, since setcontext() applies the new mask
+ * before it has finished switching off kernel_stack; they are unblocked here,
+ * once the thread is on its own stack.
+ */
+static void port_thread_start(void)
+{
+    int (*entry)(void*) = (int (*)(void*)) thread_current->regs.PC;
+    sigset_t none;
+
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+    sys_exit(entry((void*) thread_current->regs.R0));
+}
+
+void kernel_exit(void)
+{
+    uint32_t pos = thread_pos(thread_current);
+    ucontext_t* ctx = &port_thread_ctx[pos];
+
+    if(port_thread_ctx_tid[pos] != thread_current->id)
+    {
+        /*
+         * The thread has never run. Forked threads also end up here, with a
+         * copy of their parent's registers but no context of their own;
+         * fork cannot be supported on this port.
+         */
+        if(!thread_current->regs.PC)
+            kernel_panic();
+
+        memcpy(ctx, port_template(), sizeof(ucontext_t));
+        ctx->uc_stack.ss_sp = thread_mem[pos];
+        ctx->uc_stack.ss_size = THREAD_MEM_SIZE;
+        ctx->uc_link = NULL;
+        port_kernel_sigmask(&ctx->uc_sigmask);
+        makecontext(ctx, port_thread_start, 0);
+
+        port_thread_ctx_tid[pos] = thread_current->id;
+    }
+
+    setcontext(ctx);
+
+    // setcontext() only returns on failure
+    kernel_panic();
+    while(1)
+        ;
+}
+
+/*
+ * All system calls funnel through here: load the arguments into the calling
+ * thread's registers, enter the kernel, and pick the return value back out of
+ * R0 once the thread is resumed.
+ */
+static reg_t port_syscall(reg_t num, reg_t arg1, reg_t arg2, reg_t arg3)
+{
+    sigset_t tick, old;
+    thread_t* self;
+    reg_t ret;
+
+    sigemptyset(&tick);
+    sigaddset(&tick, PORT_TICK_SIGNAL);
+    sigprocmask(SIG_BLOCK, &tick, &old);
+
+    self = thread_current;
+    self->regs.PC = 0;
+    self->regs.R0 = num;
+    self->regs.R1 = arg1;
+    self->regs.R2 = arg2;
+    self->regs.R3 = arg3;
+
+    port_kernel_entry(PORT_EXCEPTION_SVC);
+
+    ret = self->regs.R0;
+    sigprocmask(SIG_SETMASK, &old, NULL);
+
+    return ret;
+}
+
+tid_t sys_get_tid()
+{
+    return (tid_t) port_syscall(SYSCALL_GET_TID, 0, 0, 0);
+}
+
+void sys_yield()
+{
+    port_syscall(SYSCALL_YIELD, 0, 0, 0);
+}
+
+int32_t sys_wait(tid_t tid)
+{
+    return (int32_t) port_syscall(SYSCALL_WAIT, tid, 0, 0);
+}
+
+bool sys_kill(tid_t tid)
+{
+    return (bool) port_syscall(SYSCALL_KILL, tid, 0, 0);
+}
+
+bool sys_lock(lock_t* l)
+{
+    return (bool) port_syscall(SYSCALL_LOCK, (reg_t) l, 0, 0);
+}
+
+void sys_unlock(lock_t* l)
+{
+    port_syscall(SYSCALL_UNLOCK, (reg_t) l, 0, 0);
+}
+
+uint32_t sys_sleep(uint32_t ms)
+{
+    return (uint32_t) port_syscall(SYSCALL_SLEEP, ms, 0, 0);
+}
+
+uint32_t sys_sleep_until(uint32_t abs_ms)
+{
+    return (uint32_t) port_syscall(SYSCALL_SLEEP_UNTIL, abs_ms, 0, 0);
+}
+
+uint32_t sys_time()
+{
+    return (uint32_t) port_syscall(SYSCALL_TIME, 0, 0, 0);
+}
+
+void sys_usleep(uint32_t us)
+{
+    port_syscall(SYSCALL_USLEEP, us, 0, 0);
+}
+
+void sys_hrtimer_set(hrtimer_t* timer, uint32_t delay_us, uint32_t period_us)
+{
+    port_syscall(SYSCALL_HRTIMER_SET, (reg_t) timer, delay_us, period_us);
+}
+
+void* sys_heap(uint32_t op, void* ptr, size_t size)
+{
+    return (void*) port_syscall(SYSCALL_HEAP, op, (reg_t) ptr, size);
+}
+
+tid_t sys_fork()
+{
+    return (tid_t) port_syscall(SYSCALL_FORK, 0, 0, 0);
+}
+
+tid_t sys_spawn(int (*entry)(void*), void* arg)
+{
+    return (tid_t) port_syscall(SYSCALL_SPAWN, (reg_t) entry, (reg_t) arg, 0);
+}
+
+tid_t sys_spawn_attr(int (*entry)(void*), void* arg, const thread_attr_t* attr)
+{
+    return (tid_t) port_syscall(SYSCALL_SPAWN_ATTR, (reg_t) entry, (reg_t) arg,
+                                (reg_t) attr);
+}
+
+bool sys_edf_set(uint32_t period_ms, uint32_t budget_ms, uint32_t deadline_ms)
+{
+    return (bool) port_syscall(SYSCALL_EDF_SET, period_ms, budget_ms,
+                               deadline_ms);
+}
+
+bool sys_edf_wait(void)
+{
+    return (bool) port_syscall(SYSCALL_EDF_WAIT, 0, 0, 0);
+}
+
+bool sys_set_weight(tid_t tid, uint32_t weight)
+{
+    return (bool) port_syscall(SYSCALL_SET_WEIGHT, tid, weight, 0);
+}
+
+bool sys_set_budget(tid_t tid, uint32_t budget_ms, uint32_t period_ms)
+{
+    return (bool) port_syscall(SYSCALL_SET_BUDGET, tid, budget_ms, period_ms);
+}
+
+uint32_t sys_thread_stats(tstat_t* buf, uint32_t len)
+{
+    return (uint32_t) port_syscall(SYSCALL_THREAD_STATS, (reg_t) buf, len,
+                                   0);
+}
+
+bool sys_event_wait(event_t* ev, uint32_t seen, uint32_t timeout_ms)
+{
+    return (bool) port_syscall(SYSCALL_EVENT_WAIT, (reg_t) ev, seen,
+                               timeout_ms);
+}
+
+void sys_timer_set(swtimer_t* timer, uint32_t delay_ms, uint32_t period_ms)
+{
+    port_syscall(SYSCALL_TIMER_SET, (reg_t) timer, delay_ms, period_ms);
+}
+
+swtimer_t* sys_timer_next()
+{
+    return (swtimer_t*) port_syscall(SYSCALL_TIMER_NEXT, 0, 0, 0);
+}
+
+void sys_exit(int status)
+{
+    port_syscall(SYSCALL_EXIT, (reg_t) status, 0, 0);
+    while(1)
+        ;
+}
+
+void sys_reset()
+{
+    port_syscall(SYSCALL_RESET, 0, 0, 0);
+    while(1)
+        ;
+}
@@ -0,0 +1,169 @@
+/**
+ * @brief Host (Linux/POSIX) implementation of the port layer (see port.h).
+ * The scheduler tick is delivered as PORT_TICK_SIGNAL by an interval timer.
+ */
+
+#define _GNU_SOURCE
+
+#include "port.h"
+#include "port_host.h"
+#include "thread.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+uint64_t port_time_base;
+
+// The emulated exclusive monitor; see port_load_exclusive()
+static volatile uintptr_t* port_exclusive_addr;
+
+volatile bool port_switch_pending;
+
+static void port_tick_handler(int sig, siginfo_t* info, void* uc)
+{
+    (void) sig;
+    (void) info;
+
+    port_clear_exclusive();
+
+    // The kernel has not been initialized yet
+    if(!thread_current)
+        return;
+
+    // Record where the thread was interrupted, as the exception frame does
+    thread_current->regs.PC =
+            (reg_t)((ucontext_t*) uc)->uc_mcontext.gregs[REG_RIP];
+
+    port_kernel_entry(PORT_EXCEPTION_TICK);
+}
+
+void port_tick_start(uint32_t freq)
+{
+    struct sigaction sa;
+    struct itimerval it;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    port_time_base = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = port_tick_handler;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    // The board's stand-in interrupts wait for the tick to enter the kernel,
+    // as interrupts at the kernel's priority do on the target
+    port_kernel_sigmask(&sa.sa_mask);
+    sigaction(PORT_TICK_SIGNAL, &sa, NULL);
+
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = 1000000 / freq;
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_REAL, &it, NULL);
+}
+
+uintptr_t port_load_exclusive(volatile uintptr_t* addr)
+{
+    port_exclusive_addr = addr;
+    return *addr;
+}
+
+bool port_store_exclusive(volatile uintptr_t* addr, uintptr_t value)
+{
+    sigset_t all, old;
+    bool ok;
+
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &old);
+
+    ok = (port_exclusive_addr == addr);
+    if(ok)
+        *addr = value;
+    port_exclusive_addr = NULL;
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return ok;
+}
+
+void port_clear_exclusive(void)
+{
+    port_exclusive_addr = NULL;
+}
+
+/*
+ * Nesting depth of port_irq_mask(), and the signal mask to put back when the
+ * outermost one is undone. A thread cannot be switched away while signals
+ * are masked, so one of each will do.
+ */
+static uint32_t port_irq_depth;
+static sigset_t port_irq_saved;
+
+void port_irq_init(void)
+{
+}
+
+void port_irq_set_priority(uint32_t irq, uint32_t priority)
+{
+    (void) irq;
+    (void) priority;
+}
+
+void port_kernel_sigmask(sigset_t* set)
+{
+    sigfillset(set);
+    sigdelset(set, PORT_ZERO_LATENCY_SIGNAL);
+}
+
+uint32_t port_irq_mask(void)
+{
+    sigset_t all, old;
+
+    port_kernel_sigmask(&all);
+    sigprocmask(SIG_BLOCK, &all, &old);
+    if(port_irq_depth++ == 0)
+        port_irq_saved = old;
+    return port_irq_depth;
+}
+
+void port_irq_restore(uint32_t old)
+{
+    (void) old;
+
+    if(--port_irq_depth == 0)
+        sigprocmask(SIG_SETMASK, &port_irq_saved, NULL);
+}
+
+void port_preempt(void)
+{
+    sigset_t tick, old;
+
+    sigemptyset(&tick);
+    sigaddset(&tick, PORT_TICK_SIGNAL);
+    sigprocmask(SIG_BLOCK, &tick, &old);
+
+    port_switch_pending = false;
+    port_kernel_entry(PORT_EXCEPTION_PENDSV);
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+void port_isr_exit(void)
+{
+    if(!port_switch_pending || !thread_current)
+        return;
+
+    port_switch_pending = false;
+    port_kernel_entry(PORT_EXCEPTION_PENDSV);
+}
+
+void port_reset(void)
+{
+    exit(EXIT_SUCCESS);
+}
+
+void port_halt(void)
+{
+    abort();
+}
@@ -0,0 +1,50 @@
+/*
+ * port_host.h
+ *
+ * Internals shared by the host port's source files.
+ */
+
+#ifndef PORT_HOST_H_
+#define PORT_HOST_H_
+
+#include <signal.h>
+
+// The signal that stands in for the SysTick interrupt
+#define PORT_TICK_SIGNAL (SIGALRM)
+
+/*
+ * The one signal that the kernel and critical_enter() leave unmasked, for a
+ * board to stand in for a zero-latency interrupt (see PORT_KERNEL_PRIORITY)
+ */
+#define PORT_ZERO_LATENCY_SIGNAL (SIGRTMIN + 1)
+
+/**
+ * @brief Fills set with every signal but PORT_ZERO_LATENCY_SIGNAL: the mask
+ * the kernel runs with.
+ */
+void port_kernel_sigmask(sigset_t* set);
+
+// The exceptions that can enter the kernel
+#define PORT_EXCEPTION_SVC    (11)
+#define PORT_EXCEPTION_PENDSV (14)
+#define PORT_EXCEPTION_TICK   (15)
+
+/**
+ * @brief Saves thread_current and enters the kernel on the kernel stack.
+ * Returns when thread_current is next resumed. The caller must have
+ * PORT_TICK_SIGNAL blocked.
+ *
+ * @param exception PORT_EXCEPTION_SVC, PORT_EXCEPTION_PENDSV or
+ * PORT_EXCEPTION_TICK.
+ */
+void port_kernel_entry(int exception);
+
+/**
+ * @brief Called at the end of the board's signal handlers, which stand in for
+ * interrupts. If the handler pended a switch (see port_pend_switch()),
+ * enters the kernel as PendSV would on the target. The caller must have
+ * PORT_TICK_SIGNAL blocked.
+ */
+void port_isr_exit(void);
+
+#endif /* PORT_HOST_H_ */
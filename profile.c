@@ -0,0 +1,107 @@
+/**
+ * @brief Statistical PC-sampling profiler; see profile.h.
+ */
+
+#include "profile.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if KERNEL_PROFILE
+
+static profile_entry_t profile_buf[PROFILE_BUF_SIZE];
+static uint32_t profile_samples;
+static uint32_t profile_dropped;
+static volatile bool profile_paused;
+
+// Maximum number of slots probed before a sample is dropped
+#define PROFILE_MAX_PROBE (16)
+
+/**
+ * @brief Adds one sample to the histogram. Called by the kernel on every
+ * scheduler tick, with the interrupted thread's PC.
+ */
+void profile_sample(tid_t tid, reg_t pc)
+{
+    uint32_t i, h;
+    profile_entry_t* e;
+
+    if(profile_paused)
+        return;
+
+    profile_samples++;
+
+    // Thumb instructions are halfword aligned; bit 0 carries no information
+    h = (uint32_t)(pc >> 1) * 2654435761u ^ tid;
+
+    for(i = 0; i < PROFILE_MAX_PROBE; i++)
+    {
+        e = &profile_buf[(h + i) & (PROFILE_BUF_SIZE - 1)];
+
+        if(e->count && e->pc == pc && e->tid == tid)
+        {
+            e->count++;
+            return;
+        }
+
+        if(!e->count)
+        {
+            e->pc = pc;
+            e->tid = tid;
+            e->count = 1;
+            return;
+        }
+    }
+
+    profile_dropped++;
+}
+
+/**
+ * @brief Clears the histogram.
+ */
+void profile_reset(void)
+{
+    profile_paused = true;
+    memset(profile_buf, 0, sizeof(profile_buf));
+    profile_samples = 0;
+    profile_dropped = 0;
+    profile_paused = false;
+}
+
+/**
+ * @brief Writes the histogram to a serial port. Sampling is paused for the
+ * duration. The histogram is not cleared; call profile_reset() for that.
+ *
+ * @param module The serial port to write to.
+ */
+void profile_dump(Serial_module_e module)
+{
+    uint32_t header[6], i, count = 0;
+
+    profile_paused = true;
+
+    for(i = 0; i < PROFILE_BUF_SIZE; i++)
+    {
+        if(profile_buf[i].count)
+            count++;
+    }
+
+    header[0] = PROFILE_MAGIC;
+    header[1] = KERNEL_SCHEDULER_IRQ_FREQ;
+    header[2] = sizeof(reg_t);
+    header[3] = profile_samples;
+    header[4] = profile_dropped;
+    header[5] = count;
+    Serial_writebuf(module, (const uint8_t*) header, sizeof(header));
+
+    for(i = 0; i < PROFILE_BUF_SIZE; i++)
+    {
+        if(profile_buf[i].count)
+            Serial_writebuf(module, (const uint8_t*) &profile_buf[i],
+                            sizeof(profile_entry_t));
+    }
+
+    profile_paused = false;
+}
+
+#endif
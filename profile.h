@@ -0,0 +1,60 @@
+/*
+ * profile.h
+ *
+ * Statistical PC-sampling profiler. When KERNEL_PROFILE is enabled, every
+ * scheduler tick records the (tid, PC) at which the current thread was
+ * interrupted into a fixed-size histogram. The histogram is an open-addressed
+ * hash table keyed on (tid, PC); samples that find it full are counted as
+ * dropped.
+ *
+ * profile_dump() writes the histogram to a serial port in the binary format
+ * below; tools/profile_symbolize.py resolves the PCs against main.elf.
+ *
+ * Dump format (all fields little-endian):
+ *      uint32_t magic          PROFILE_MAGIC
+ *      uint32_t sample_hz      KERNEL_SCHEDULER_IRQ_FREQ
+ *      uint32_t pc_bytes       sizeof(reg_t)
+ *      uint32_t samples        total samples taken, including dropped ones
+ *      uint32_t dropped        samples that did not fit in the histogram
+ *      uint32_t count          number of entries that follow
+ *      profile_entry_t entries[count]
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "kernel.h"
+#include "thread.h"
+#include "drivers/driver_serial.h"
+
+#include <stdint.h>
+
+#ifndef PROFILE_BUF_SIZE
+#define PROFILE_BUF_SIZE (256) // entries; must be a power of two
+#endif
+
+#define PROFILE_MAGIC (0x31465250) // "PRF1"
+
+// Type for a histogram entry
+typedef struct
+{
+    reg_t pc;
+    uint32_t tid;
+    uint32_t count;
+} profile_entry_t;
+
+#if KERNEL_PROFILE
+
+void profile_sample(tid_t tid, reg_t pc);
+void profile_dump(Serial_module_e module);
+void profile_reset(void);
+
+#else
+
+#define profile_sample(tid, pc) do { } while(0)
+#define profile_dump(module) do { } while(0)
+#define profile_reset() do { } while(0)
+
+#endif
+
+#endif /* PROFILE_H_ */
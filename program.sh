@@ -14,8 +14,24 @@ debug()
     killall openocd
 }
 
+# Run main.elf on QEMU's model of the MPS2 AN386 board (configure.py
+# --board mps2_an386). The console UART is attached to the terminal; with -d,
+# QEMU waits for gdb on :1234.
+emulate()
+{
+    if [[ $D_FLAG == 1 ]]
+    then
+        qemu-system-arm -machine mps2-an386 -nographic -kernel main.elf -s -S &
+        arm-none-eabi-gdb -ex "target remote :1234" main.elf
+        kill %1
+    else
+        qemu-system-arm -machine mps2-an386 -nographic -kernel main.elf
+    fi
+}
+
 P_FLAG=0
 D_FLAG=0
+Q_FLAG=0
 
 for i in $@
 do
@@ -28,8 +44,19 @@ do
     then
         D_FLAG=1
     fi
+
+    if [[ $i == -q ]]
+    then
+        Q_FLAG=1
+    fi
 done
 
+if [[ $Q_FLAG == 1 ]]
+then
+    emulate
+    exit
+fi
+
 if [[ $P_FLAG == 1 ]]
 then
     program
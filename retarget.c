@@ -0,0 +1,87 @@
+/**
+ * @brief newlib's system call layer for the boards: standard input, output
+ * and error are the debug serial port. With THREAD_REENT every thread has
+ * its own stdio streams and errno, so threads can printf() without a lock.
+ * Output is line buffered, and a line that fits in the buffer goes out in
+ * one _write(), so lines from different threads do not interleave.
+ *
+ * Not built on the host, where glibc talks to the real file descriptors.
+ */
+
+#ifndef PORT_HOST
+
+#include "drivers/driver_serial.h"
+#include "thread.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// stdio buffer size, reported as the serial port's block size
+#ifndef RETARGET_BUFSIZE
+#define RETARGET_BUFSIZE (128)
+#endif
+
+#define STDIN_FD (0)
+#define STDOUT_FD (1)
+#define STDERR_FD (2)
+
+int _write(int fd, const char* buf, int len)
+{
+    if(fd != STDOUT_FD && fd != STDERR_FD)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    Serial_writebuf(Serial_module_debug, (const uint8_t*) buf, len);
+    return len;
+}
+
+/*
+ * Blocks until at least one byte has arrived. Before kernel_init() it does
+ * not block, and 0 reads as end of file.
+ */
+int _read(int fd, char* buf, int len)
+{
+    if(fd != STDIN_FD)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    return (int) Serial_read(Serial_module_debug, (uint8_t*) buf, len,
+                             EVENT_WAIT_FOREVER);
+}
+
+int _close(int fd)
+{
+    (void) fd;
+    return 0;
+}
+
+int _fstat(int fd, struct stat* st)
+{
+    (void) fd;
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFCHR;
+    st->st_blksize = RETARGET_BUFSIZE;
+    return 0;
+}
+
+int _isatty(int fd)
+{
+    return fd <= STDERR_FD;
+}
+
+int _lseek(int fd, int offset, int whence)
+{
+    (void) fd;
+    (void) offset;
+    (void) whence;
+    errno = ESPIPE;
+    return -1;
+}
+
+#endif
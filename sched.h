@@ -0,0 +1,133 @@
+/*
+ * sched.h
+ *
+ * The interface between the kernel and its scheduling policy. The kernel
+ * keeps thread states and time slices; the policy decides which runnable
+ * thread runs next, and is told when threads join and leave the runnable
+ * set, which it keeps in run queues (sched_queue_t) so that a pick does not
+ * have to look through the thread table. The running thread stays on its
+ * queue. One policy is built into the kernel, chosen with
+ * KERNEL_SCHED_POLICY:
+ *
+ *     SCHED_POLICY_RR    sched_rr.c    threads take turns; priorities are
+ *                                      ignored
+ *     SCHED_POLICY_PRIO  sched_prio.c  the highest priority runs; threads of
+ *                                      equal priority take turns, or share
+ *                                      by weight with KERNEL_FAIR_SHARE
+ *     SCHED_POLICY_EDF   sched_edf.c   earliest-deadline-first threads (see
+ *                                      sys_edf_set()) ahead of the rest,
+ *                                      which are scheduled as with
+ *                                      SCHED_POLICY_PRIO (the default)
+ *
+ * Every policy file is compiled, but only the selected one defines the
+ * functions below, so the kernel calls them directly: the choice is made when
+ * the kernel is linked and costs no function pointers at run time.
+ *
+ * All of them run in the kernel, with the thread table to themselves. The
+ * kernel takes a runnable thread off its queue before it changes anything a
+ * policy sorts by (its earliest-deadline-first parameters), and puts it back
+ * afterwards.
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include "kernel.h"
+#include "thread.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if KERNEL_SCHED_POLICY != SCHED_POLICY_RR &&                                 \
+    KERNEL_SCHED_POLICY != SCHED_POLICY_PRIO &&                               \
+    KERNEL_SCHED_POLICY != SCHED_POLICY_EDF
+#error "KERNEL_SCHED_POLICY must be SCHED_POLICY_RR, _PRIO or _EDF"
+#endif
+
+#if KERNEL_FAIR_SHARE && KERNEL_SCHED_POLICY == SCHED_POLICY_RR
+#error "KERNEL_FAIR_SHARE needs SCHED_POLICY_PRIO or SCHED_POLICY_EDF"
+#endif
+
+// A run queue: threads doubly linked through rq_next and rq_prev
+typedef struct
+{
+    thread_t* head;
+    thread_t* tail;
+} sched_queue_t;
+
+static inline bool sched_queue_has(const sched_queue_t* q,
+                                   const thread_t* thread)
+{
+    return thread->rq_prev || q->head == thread;
+}
+
+/**
+ * @brief Links thread into q ahead of pos, or at the tail if pos is NULL.
+ * thread must not be on a queue.
+ */
+static inline void sched_queue_insert(sched_queue_t* q, thread_t* thread,
+                                      thread_t* pos)
+{
+    thread->rq_next = pos;
+    thread->rq_prev = pos ? pos->rq_prev : q->tail;
+
+    if(thread->rq_prev)
+        thread->rq_prev->rq_next = thread;
+    else
+        q->head = thread;
+
+    if(pos)
+        pos->rq_prev = thread;
+    else
+        q->tail = thread;
+}
+
+/**
+ * @brief Unlinks thread, which must be on q.
+ */
+static inline void sched_queue_remove(sched_queue_t* q, thread_t* thread)
+{
+    if(thread->rq_prev)
+        thread->rq_prev->rq_next = thread->rq_next;
+    else
+        q->head = thread->rq_next;
+
+    if(thread->rq_next)
+        thread->rq_next->rq_prev = thread->rq_prev;
+    else
+        q->tail = thread->rq_prev;
+
+    thread->rq_next = NULL;
+    thread->rq_prev = NULL;
+}
+
+/**
+ * @brief Returns the runnable thread to run next, or NULL if there is none.
+ * If it is not continuing a time slice, it is given a fresh one.
+ */
+thread_t* sched_pick(void);
+
+/**
+ * @brief Called when thread joins the runnable set: when it is spawned and
+ * when it wakes up. Does nothing if it is already queued.
+ */
+void sched_enqueue(thread_t* thread);
+
+/**
+ * @brief Called when a runnable thread leaves the runnable set: when it
+ * sleeps, blocks or is killed. Does nothing if it is not queued.
+ */
+void sched_dequeue(thread_t* thread);
+
+/**
+ * @brief Whether thread, which has just become runnable, should run ahead of
+ * current rather than wait for current's time slice to end.
+ */
+bool sched_preempts(const thread_t* thread, const thread_t* current);
+
+// Used by sched_edf.c for the threads outside its class; see sched_prio.c
+thread_t* sched_prio_pick(void);
+void sched_prio_enqueue(thread_t* thread);
+void sched_prio_dequeue(thread_t* thread);
+
+#endif /* SCHED_H_ */
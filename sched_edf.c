@@ -0,0 +1,78 @@
+/**
+ * @brief Earliest-deadline-first scheduling policy (SCHED_POLICY_EDF); see
+ * sched.h.
+ *
+ * Runnable threads in the earliest-deadline-first class (see sys_edf_set())
+ * come before all others, and the one whose current job is due first runs.
+ * They are kept in a queue sorted by edf_due, so a pick takes the head and
+ * a wakeup walks the class to find its place. When none is runnable, the
+ * rest are scheduled by priority, by sched_prio.c. Admission control and
+ * job releases are in kernel.c.
+ */
+
+#include "sched.h"
+
+#if KERNEL_SCHED_POLICY == SCHED_POLICY_EDF
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Runnable earliest-deadline-first threads, the earliest edf_due first
+static sched_queue_t sched_edf_queue;
+
+thread_t* sched_pick(void)
+{
+    thread_t* edf = sched_edf_queue.head;
+
+    if(!edf)
+        return sched_prio_pick();
+
+    if(!edf->slice)
+        edf->slice = edf->quantum;
+    return edf;
+}
+
+/*
+ * Threads due at the same time run in the order they became runnable.
+ */
+void sched_enqueue(thread_t* thread)
+{
+    thread_t* pos;
+
+    if(!thread->edf_period)
+    {
+        sched_prio_enqueue(thread);
+        return;
+    }
+
+    if(sched_queue_has(&sched_edf_queue, thread))
+        return;
+
+    for(pos = sched_edf_queue.head; pos; pos = pos->rq_next)
+    {
+        if(pos->edf_due > thread->edf_due)
+            break;
+    }
+    sched_queue_insert(&sched_edf_queue, thread, pos);
+}
+
+void sched_dequeue(thread_t* thread)
+{
+    if(!thread->edf_period)
+        sched_prio_dequeue(thread);
+    else if(sched_queue_has(&sched_edf_queue, thread))
+        sched_queue_remove(&sched_edf_queue, thread);
+}
+
+/*
+ * An earliest-deadline-first thread preempts threads outside the class and
+ * those with later deadlines; other threads preempt those of lower priority.
+ */
+bool sched_preempts(const thread_t* thread, const thread_t* current)
+{
+    if(thread->edf_period)
+        return !current->edf_period || thread->edf_due < current->edf_due;
+    return !current->edf_period && thread->priority > current->priority;
+}
+
+#endif
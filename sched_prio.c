@@ -0,0 +1,172 @@
+/**
+ * @brief Fixed-priority scheduling policy (SCHED_POLICY_PRIO); see sched.h.
+ *
+ * The runnable threads of the highest priority present share the CPU, and
+ * lower priorities wait. Each priority has a queue of its runnable threads,
+ * and a bitmap records which queues are not empty, so finding the highest
+ * priority takes one count-leading-zeros. Within a priority, threads take
+ * turns, a time slice each, in the order they became runnable, or with
+ * KERNEL_FAIR_SHARE the one furthest behind its weighted share runs, found
+ * by a scan of that priority's queue. sched_edf.c uses the same code for
+ * the threads outside its class, which is why it is built with
+ * SCHED_POLICY_EDF too; earliest-deadline-first threads are never queued
+ * here.
+ */
+
+#include "sched.h"
+
+#if KERNEL_SCHED_POLICY == SCHED_POLICY_PRIO ||                               \
+    KERNEL_SCHED_POLICY == SCHED_POLICY_EDF
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if THREAD_PRIORITIES > 32
+#error "SCHED_POLICY_PRIO keeps one bit per priority in a uint32_t"
+#endif
+
+static sched_queue_t sched_prio_queues[THREAD_PRIORITIES];
+
+// Bit p is set while sched_prio_queues[p] is not empty
+static uint32_t sched_prio_bitmap;
+
+#if KERNEL_FAIR_SHARE
+// Virtual time of the thread last picked at each priority
+static uint64_t sched_fair_vtime[THREAD_PRIORITIES];
+
+/*
+ * Picks among the runnable threads of priority prio, of which there must be
+ * at least one, the one furthest behind its share: the one with the least
+ * virtual time (see kernel_account()). It starts a fresh slice, unless it is
+ * the running thread and has time left.
+ */
+static thread_t* sched_fair_pick(uint32_t prio)
+{
+    thread_t *thread, *best = sched_prio_queues[prio].head;
+
+    for(thread = best->rq_next; thread; thread = thread->rq_next)
+    {
+        if(thread->pass < best->pass)
+            best = thread;
+    }
+
+    if(best->pass > sched_fair_vtime[prio])
+        sched_fair_vtime[prio] = best->pass;
+    if(best != thread_current || !best->slice)
+        best->slice = best->quantum;
+    return best;
+}
+#else
+// The thread whose turn it is, per priority; at the head of its queue while
+// it is runnable
+static thread_t* sched_prio_turn[THREAD_PRIORITIES];
+
+/*
+ * Picks among the runnable threads of priority prio, of which there must be
+ * at least one, by taking turns. The thread whose turn it is carries on if
+ * it still has time left in its slice, i.e. if it was only preempted by a
+ * thread of higher priority; otherwise it goes to the back of the queue and
+ * the turn passes to the thread at the head, which starts a fresh slice.
+ */
+static thread_t* sched_rr_pick(uint32_t prio)
+{
+    sched_queue_t* q = &sched_prio_queues[prio];
+    thread_t* thread = q->head;
+
+    if(thread == sched_prio_turn[prio])
+    {
+        if(thread->slice)
+            return thread;
+
+        sched_queue_remove(q, thread);
+        sched_queue_insert(q, thread, NULL);
+        thread = q->head;
+    }
+
+    thread->slice = thread->quantum;
+    sched_prio_turn[prio] = thread;
+    return thread;
+}
+#endif
+
+/**
+ * @brief Picks a runnable thread of the highest priority present, or returns
+ * NULL if there is none.
+ */
+thread_t* sched_prio_pick(void)
+{
+    uint32_t prio;
+
+    if(!sched_prio_bitmap)
+        return NULL;
+
+    prio = 31 - __builtin_clz(sched_prio_bitmap);
+
+#if KERNEL_FAIR_SHARE
+    return sched_fair_pick(prio);
+#else
+    return sched_rr_pick(prio);
+#endif
+}
+
+/**
+ * @brief Queues a thread that is joining the runnable set behind the others
+ * of its priority. With KERNEL_FAIR_SHARE, also brings it up to the virtual
+ * time of its priority, so that time spent asleep or not yet spawned does
+ * not count as a share it is owed.
+ */
+void sched_prio_enqueue(thread_t* thread)
+{
+    sched_queue_t* q = &sched_prio_queues[thread->priority];
+
+    if(sched_queue_has(q, thread))
+        return;
+
+#if KERNEL_FAIR_SHARE
+    if(thread->pass < sched_fair_vtime[thread->priority])
+        thread->pass = sched_fair_vtime[thread->priority];
+#endif
+
+    sched_queue_insert(q, thread, NULL);
+    sched_prio_bitmap |= 1u << thread->priority;
+}
+
+/**
+ * @brief Takes a thread that is leaving the runnable set off its priority's
+ * queue.
+ */
+void sched_prio_dequeue(thread_t* thread)
+{
+    sched_queue_t* q = &sched_prio_queues[thread->priority];
+
+    if(!sched_queue_has(q, thread))
+        return;
+
+    sched_queue_remove(q, thread);
+    if(!q->head)
+        sched_prio_bitmap &= ~(1u << thread->priority);
+}
+
+#if KERNEL_SCHED_POLICY == SCHED_POLICY_PRIO
+thread_t* sched_pick(void)
+{
+    return sched_prio_pick();
+}
+
+void sched_enqueue(thread_t* thread)
+{
+    sched_prio_enqueue(thread);
+}
+
+void sched_dequeue(thread_t* thread)
+{
+    sched_prio_dequeue(thread);
+}
+
+bool sched_preempts(const thread_t* thread, const thread_t* current)
+{
+    return thread->priority > current->priority;
+}
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @brief Round-robin scheduling policy (SCHED_POLICY_RR); see sched.h.
+ *
+ * Runnable threads take turns, a time slice each, whatever their priorities,
+ * in the order they became runnable. They wait in a single queue; the thread
+ * whose turn it is sits at its head, and goes to the back when its turn ends.
+ */
+
+#include "sched.h"
+
+#if KERNEL_SCHED_POLICY == SCHED_POLICY_RR
+
+#include <stddef.h>
+#include <stdint.h>
+
+static sched_queue_t sched_rr_queue;
+
+// The thread whose turn it is; at the head of the queue while it is runnable
+static thread_t* sched_rr_turn;
+
+/*
+ * The thread whose turn it is carries on while it has time left in its
+ * slice; otherwise the turn passes to the next runnable thread, which starts
+ * a fresh slice.
+ */
+thread_t* sched_pick(void)
+{
+    thread_t* thread = sched_rr_queue.head;
+
+    if(thread && thread == sched_rr_turn)
+    {
+        if(thread->slice)
+            return thread;
+
+        sched_queue_remove(&sched_rr_queue, thread);
+        sched_queue_insert(&sched_rr_queue, thread, NULL);
+        thread = sched_rr_queue.head;
+    }
+
+    if(!thread)
+        return NULL;
+
+    thread->slice = thread->quantum;
+    sched_rr_turn = thread;
+    return thread;
+}
+
+void sched_enqueue(thread_t* thread)
+{
+    if(!sched_queue_has(&sched_rr_queue, thread))
+        sched_queue_insert(&sched_rr_queue, thread, NULL);
+}
+
+void sched_dequeue(thread_t* thread)
+{
+    if(sched_queue_has(&sched_rr_queue, thread))
+        sched_queue_remove(&sched_rr_queue, thread);
+}
+
+bool sched_preempts(const thread_t* thread, const thread_t* current)
+{
+    (void) thread;
+    (void) current;
+    return false;
+}
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * @brief Software timer wheel and service thread; see swtimer.h.
+ *
+ * Everything below the user API runs in the kernel, from the scheduler tick
+ * or from the SYSCALL_TIMER_SET and SYSCALL_TIMER_NEXT handlers, so the
+ * lists need no locking.
+ */
+
+#include "swtimer.h"
+#include "kernel.h"
+#include "syscalls.h"
+#include "trace.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SWTIMER_WHEEL_MASK (SWTIMER_WHEEL_SIZE - 1)
+
+#if (SWTIMER_WHEEL_SIZE & SWTIMER_WHEEL_MASK) != 0
+#error "SWTIMER_WHEEL_SIZE must be a power of two"
+#endif
+
+extern tsleep_t systime_ms;
+
+/*
+ * Circular lists with sentinel heads: one per wheel slot, holding the timers
+ * whose expiry maps to it, and the queue of expired timers waiting for the
+ * service thread, oldest first.
+ */
+static swtimer_link_t swtimer_wheel[SWTIMER_WHEEL_SIZE];
+static swtimer_link_t swtimer_expired;
+
+// The service thread, while it is blocked waiting for a timer to expire
+thread_t* swtimer_waiter;
+
+static void swtimer_list_init(swtimer_link_t* head)
+{
+    head->next = head->prev = head;
+}
+
+static void swtimer_append(swtimer_link_t* head, swtimer_link_t* link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void swtimer_unlink(swtimer_link_t* link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = link->prev = NULL;
+}
+
+static void swtimer_arm(swtimer_t* timer)
+{
+    swtimer_append(&swtimer_wheel[timer->expiry & SWTIMER_WHEEL_MASK],
+                   &timer->link);
+}
+
+/**
+ * @brief Initializes the wheel. Called from kernel_init().
+ */
+void swtimer_kernel_init(void)
+{
+    int i;
+
+    for(i = 0; i < SWTIMER_WHEEL_SIZE; i++)
+        swtimer_list_init(&swtimer_wheel[i]);
+    swtimer_list_init(&swtimer_expired);
+    swtimer_waiter = NULL;
+}
+
+/**
+ * @brief Stops timer, wherever it is, and restarts it to expire delay ticks
+ * from now and then every period ticks. A delay of 0 only stops it.
+ */
+void swtimer_set(swtimer_t* timer, uint32_t delay, uint32_t period)
+{
+    if(timer->link.next)
+        swtimer_unlink(&timer->link);
+
+    if(!delay)
+        return;
+
+    timer->expiry = systime_ms + delay;
+    timer->period = period;
+    timer->overruns = 0;
+    swtimer_arm(timer);
+}
+
+/**
+ * @brief Takes the oldest expired timer off the queue, rearming it first if
+ * it is periodic.
+ *
+ * @return The timer, or NULL if none has expired.
+ */
+swtimer_t* swtimer_next(void)
+{
+    swtimer_t* timer;
+
+    if(swtimer_expired.next == &swtimer_expired)
+        return NULL;
+
+    timer = (swtimer_t*) swtimer_expired.next;
+    swtimer_unlink(&timer->link);
+
+    if(timer->period)
+    {
+        timer->expiry += timer->period;
+        while((int32_t)(timer->expiry - systime_ms) <= 0)
+        {
+            timer->expiry += timer->period;
+            timer->overruns++;
+        }
+        swtimer_arm(timer);
+    }
+
+    return timer;
+}
+
+/**
+ * @brief Moves the timers that expire at this tick to the expired queue and
+ * hands the first one straight to the service thread if it is waiting.
+ * Called from kernel_tick_counter() after systime_ms has advanced.
+ */
+void swtimer_tick(void)
+{
+    swtimer_link_t* head = &swtimer_wheel[systime_ms & SWTIMER_WHEEL_MASK];
+    swtimer_link_t* link;
+    swtimer_link_t* next;
+
+    for(link = head->next; link != head; link = next)
+    {
+        next = link->next;
+        if(((swtimer_t*) link)->expiry == systime_ms)
+        {
+            swtimer_unlink(link);
+            swtimer_append(&swtimer_expired, link);
+        }
+    }
+
+    // The service thread may have been killed while it waited
+    if(swtimer_waiter && (swtimer_waiter->state != T_BLOCKED ||
+                          swtimer_waiter->waitstat != WAITSTATUS_TIMER))
+        swtimer_waiter = NULL;
+
+    if(swtimer_waiter && swtimer_expired.next != &swtimer_expired)
+    {
+        swtimer_waiter->regs.R0 = (reg_t) swtimer_next();
+        swtimer_waiter->waitstat = WAITSTATUS_NONE;
+        kernel_wake(swtimer_waiter);
+        trace_event(TRACE_WAKEUP, swtimer_waiter->id, 0);
+        swtimer_waiter = NULL;
+    }
+}
+
+/**
+ * @brief Prepares a timer. It does nothing until swtimer_start().
+ */
+void swtimer_init(swtimer_t* timer, void (*fn)(void*), void* ctx)
+{
+    timer->link.next = timer->link.prev = NULL;
+    timer->fn = fn;
+    timer->ctx = ctx;
+    timer->period = 0;
+    timer->overruns = 0;
+}
+
+/**
+ * @brief Starts (or restarts) a timer.
+ *
+ * @param delay_ms Time until the first call; rounded up to one tick.
+ * @param period_ms Time between later calls; 0 for a one-shot timer.
+ */
+void swtimer_start(swtimer_t* timer, uint32_t delay_ms, uint32_t period_ms)
+{
+    sys_timer_set(timer, delay_ms ? delay_ms : 1, period_ms);
+}
+
+/**
+ * @brief Stops a timer. Its callback will not be called again, unless the
+ * service thread is already running it.
+ */
+void swtimer_cancel(swtimer_t* timer)
+{
+    sys_timer_set(timer, 0, 0);
+}
+
+static int swtimer_service_main(void* arg)
+{
+    swtimer_t* timer;
+
+    (void) arg;
+
+    while(1)
+    {
+        timer = sys_timer_next();
+        timer->fn(timer->ctx);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Spawns the timer service thread. Only one may run.
+ *
+ * @return Its tid, or 0 if no thread slot was free.
+ */
+tid_t swtimer_service_start(void)
+{
+    return sys_spawn(swtimer_service_main, NULL);
+}
@@ -0,0 +1,68 @@
+/*
+ * swtimer.h
+ *
+ * Software timers. A swtimer_t calls fn(ctx) once, delay_ms after it is
+ * started, and then every period_ms if it is periodic. Callbacks run in the
+ * timer service thread (swtimer_service_start()), one at a time, so one
+ * thread serves any number of timers; a callback that blocks delays the
+ * ones behind it.
+ *
+ * Timers live in a hashed timing wheel of SWTIMER_WHEEL_SIZE slots, indexed
+ * by expiry tick. Starting and cancelling a timer is O(1); each scheduler
+ * tick only looks at the timers in one slot. Expired timers are queued for
+ * the service thread by the tick itself, and a periodic timer's next expiry
+ * is its previous expiry plus the period, so it does not drift however late
+ * its callbacks run. If the service thread falls more than a whole period
+ * behind, the missed expiries are skipped and counted in overruns.
+ *
+ * The wheel belongs to the kernel: swtimer_start() and swtimer_cancel() are
+ * system calls, and may not be used from ISRs.
+ */
+
+#ifndef SWTIMER_H_
+#define SWTIMER_H_
+
+#include "thread.h"
+
+#include <stdint.h>
+
+#ifndef SWTIMER_WHEEL_SIZE
+#define SWTIMER_WHEEL_SIZE (32) // slots; must be a power of two
+#endif
+
+// Type for a timer list link
+typedef struct swtimer_link
+{
+    struct swtimer_link* next;
+    struct swtimer_link* prev;
+} swtimer_link_t;
+
+// Type for a software timer
+typedef struct
+{
+    // Wheel slot or expired queue membership; NULL next when in neither.
+    // Must be the first member.
+    swtimer_link_t link;
+    tsleep_t expiry;
+    // In ticks; 0 for a one-shot timer
+    uint32_t period;
+    void (*fn)(void* ctx);
+    void* ctx;
+    // Periodic expiries skipped because the service thread was too late
+    uint32_t overruns;
+} swtimer_t;
+
+void swtimer_init(swtimer_t* timer, void (*fn)(void*), void* ctx);
+void swtimer_start(swtimer_t* timer, uint32_t delay_ms, uint32_t period_ms);
+void swtimer_cancel(swtimer_t* timer);
+tid_t swtimer_service_start(void);
+
+// Kernel side; see swtimer.c
+void swtimer_kernel_init(void);
+void swtimer_set(swtimer_t* timer, uint32_t delay, uint32_t period);
+swtimer_t* swtimer_next(void);
+void swtimer_tick(void);
+
+extern thread_t* swtimer_waiter;
+
+#endif /* SWTIMER_H_ */
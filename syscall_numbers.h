@@ -26,5 +26,19 @@
 #define SYSCALL_GET_TID       	(8)
 #define SYSCALL_LOCK          	(9)
 #define SYSCALL_UNLOCK        	(10)
+#define SYSCALL_THREAD_STATS  	(11)
+#define SYSCALL_EVENT_WAIT    	(12)
+#define SYSCALL_TIMER_SET     	(13)
+#define SYSCALL_TIMER_NEXT    	(14)
+#define SYSCALL_SLEEP_UNTIL   	(15)
+#define SYSCALL_TIME          	(16)
+#define SYSCALL_USLEEP        	(17)
+#define SYSCALL_HRTIMER_SET   	(18)
+#define SYSCALL_HEAP          	(19)
+#define SYSCALL_SPAWN_ATTR    	(20)
+#define SYSCALL_EDF_SET       	(21)
+#define SYSCALL_EDF_WAIT      	(22)
+#define SYSCALL_SET_WEIGHT    	(23)
+#define SYSCALL_SET_BUDGET    	(24)
 
 #endif /* SYSCALL_NUMBERS_H_ */
@@ -8,8 +8,11 @@
 #ifndef SYSCALLS_H_
 #define SYSCALLS_H_
 
+#include "hrtimer.h"
+#include "swtimer.h"
 #include "thread.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 extern tid_t sys_get_tid();
@@ -19,8 +22,26 @@ extern bool sys_kill(tid_t tid);
 extern bool sys_lock(lock_t* l);
 extern void sys_unlock(lock_t* l);
 extern uint32_t sys_sleep(uint32_t ms);
+extern uint32_t sys_sleep_until(uint32_t abs_ms);
+extern uint32_t sys_time();
 extern tid_t sys_fork();
 extern tid_t sys_spawn(int (*entry)(void*), void* arg);
+extern tid_t sys_spawn_attr(int (*entry)(void*), void* arg,
+                            const thread_attr_t* attr);
+extern uint32_t sys_thread_stats(tstat_t* buf, uint32_t len);
+extern bool sys_edf_set(uint32_t period_ms, uint32_t budget_ms,
+                        uint32_t deadline_ms);
+extern bool sys_edf_wait(void);
+extern bool sys_set_weight(tid_t tid, uint32_t weight);
+extern bool sys_set_budget(tid_t tid, uint32_t budget_ms, uint32_t period_ms);
+extern bool sys_event_wait(event_t* ev, uint32_t seen, uint32_t timeout_ms);
+extern void sys_timer_set(swtimer_t* timer, uint32_t delay_ms,
+                          uint32_t period_ms);
+extern swtimer_t* sys_timer_next();
+extern void sys_usleep(uint32_t us);
+extern void sys_hrtimer_set(hrtimer_t* timer, uint32_t delay_us,
+                            uint32_t period_us);
+extern void* sys_heap(uint32_t op, void* ptr, size_t size);
 
 __attribute__((noreturn()))
 extern void sys_exit(int status);
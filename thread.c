@@ -8,10 +8,16 @@
  *      http://www.ti.com/lit/ds/symlink/tm4c123gh6pm.pdf
  */
 
+#include "heap.h"
+#include "kernel.h"
+#include "sched.h"
 #include "thread.h"
 
 #include <stdlib.h>
 #include <string.h>
+#if THREAD_REENT
+#include <reent.h>
+#endif
 
 thread_t thread_table[MAX_THREADS] __attribute__((aligned(0x4)));
 
@@ -117,15 +123,77 @@ bool thread_in_table(const thread_t* thread)
     return (thread_pos(thread) != MAX_THREADS);
 }
 
+/**
+ * @brief Gives a thread fresh newlib state of its own, from the heap. If the
+ * heap has no room, the thread shares the global state with thread 0.
+ */
+static void thread_reent_init(thread_t* thread)
+{
+#if THREAD_REENT
+    thread->reent = heap_kernel(HEAP_OP_ALLOC, NULL, sizeof(struct _reent));
+    if(thread->reent)
+        _REENT_INIT_PTR(thread->reent);
+    else
+        thread->reent = _global_impure_ptr;
+#endif
+}
+
+/**
+ * @brief Flushes and closes a thread's stdio streams, frees what newlib
+ * allocated for it, and gives its state back to the heap. Called from the
+ * kernel, where the flush polls the UART.
+ */
+static void thread_reent_release(thread_t* thread)
+{
+#if THREAD_REENT
+    struct _reent* reent = thread->reent;
+
+    thread->reent = _global_impure_ptr;
+    if(!reent || reent == _global_impure_ptr)
+        return;
+
+    // _reclaim_reent() leaves the running state alone
+    _impure_ptr = _global_impure_ptr;
+    _reclaim_reent(reent);
+    heap_kernel(HEAP_OP_FREE, reent, 0);
+#endif
+}
+
 static void zero_thread(thread_t* thread)
 {
     if(!thread_in_table(thread))
         return;
 
+    thread_reent_release(thread);
+
     thread->id = 0;
     thread->state = T_EMPTY;
     thread->scnt = 0;
+    thread->wake = 0;
+    thread->priority = THREAD_PRIORITY_DEFAULT;
+    thread->quantum = THREAD_QUANTUM;
+    thread->slice = 0;
+    thread->preempt_count = 0;
+    thread->weight = THREAD_WEIGHT_DEFAULT;
+    thread->pass = 0;
+    thread->budget = 0;
+    thread->budget_period = 0;
+    thread->budget_mark = 0;
+    thread->replenish = 0;
+    thread->noverrun = 0;
+    thread->edf_period = 0;
+    thread->edf_budget = 0;
+    thread->edf_deadline = 0;
+    thread->edf_release = 0;
+    thread->edf_due = 0;
+    thread->nmiss = 0;
     thread->waitstat = WAITSTATUS_NONE;
+    thread->cycles = 0;
+    thread->nswitch = 0;
+    thread->nsyscall = 0;
+    thread->npreempt = 0;
+    thread->rq_next = NULL;
+    thread->rq_prev = NULL;
 
     // Zero-initialize registers and memory.
     memset(&thread->regs, 0, sizeof(registers_t));
@@ -147,7 +215,8 @@ void thread_init(void)
 }
 
 /**
- * @brief Spawns a new thread with the given entry point and argument.
+ * @brief Spawns a new thread with the given entry point and argument, and
+ * the default scheduling attributes.
  *
  * @param entry The entry point for the thread. Accepts a void* argument and
  * returns an integer status.
@@ -155,6 +224,19 @@ void thread_init(void)
  * @return The thread ID of the spawned thread.
  */
 tid_t thread_spawn(const int (*entry)(void*), const void* arg)
+{
+    return thread_spawn_attr(entry, arg, NULL);
+}
+
+/**
+ * @brief Spawns a new thread with the given entry point, argument and
+ * scheduling attributes.
+ *
+ * @param attr The attributes, or NULL for the defaults.
+ * @return The thread ID of the spawned thread.
+ */
+tid_t thread_spawn_attr(const int (*entry)(void*), const void* arg,
+                        const thread_attr_t* attr)
 {
     int i;
     thread_t* new_thread;
@@ -185,13 +267,30 @@ tid_t thread_spawn(const int (*entry)(void*), const void* arg)
      * argument, and its stack pointer to the beginning of the thread memory
      * entry allocated for it.
      */
-    new_thread->regs.PC = (uint32_t)entry;
-    new_thread->regs.R0 = (uint32_t)arg;
-    new_thread->regs.SP = (uint32_t)&thread_mem[i+1];
+    new_thread->regs.PC = (reg_t)entry;
+    new_thread->regs.R0 = (reg_t)arg;
+    new_thread->regs.SP = (reg_t)&thread_mem[i+1];
 
     // Ensure that thumb state is enabled. [PD: 84]
     new_thread->regs.PSR = 0x01000000;
 
+    if(attr)
+    {
+        new_thread->priority = attr->priority < THREAD_PRIORITIES ?
+                               attr->priority : THREAD_PRIORITIES - 1;
+        if(attr->quantum)
+            new_thread->quantum = attr->quantum;
+        if(attr->weight)
+            new_thread->weight = attr->weight;
+        if(attr->budget && attr->budget < attr->budget_period)
+        {
+            new_thread->budget = attr->budget;
+            new_thread->budget_period = attr->budget_period;
+        }
+    }
+
+    thread_reent_init(new_thread);
+
     return new_thread->id;
 }
 
@@ -206,6 +305,9 @@ bool thread_kill(thread_t* thread)
     if(!thread_in_table(thread))
         return false;
 
+    thread_reent_release(thread);
+    if(thread->state == T_RUNNABLE)
+        sched_dequeue(thread);
     thread->state = T_ZOMBIE;
     return true;
 }
@@ -223,6 +325,9 @@ bool thread_kill2(tid_t tid)
     if(!(thread = tt_entry_for_tid(tid)))
         return false;
 
+    thread_reent_release(thread);
+    if(thread->state == T_RUNNABLE)
+        sched_dequeue(thread);
     thread->state = T_ZOMBIE;
     return true;
 }
@@ -249,6 +354,25 @@ bool thread_copy(thread_t* dest, const thread_t* src)
 
     thread_table[d_index].id = thread_fresh_tid();
 
+    // The copy starts its own accounting from zero.
+    thread_table[d_index].cycles = 0;
+    thread_table[d_index].nswitch = 0;
+    thread_table[d_index].nsyscall = 0;
+    thread_table[d_index].npreempt = 0;
+
+    // The copy joins a run queue when the kernel makes it runnable
+    thread_table[d_index].rq_next = NULL;
+    thread_table[d_index].rq_prev = NULL;
+
+    // Only admitted threads may be earliest-deadline-first
+    thread_table[d_index].edf_period = 0;
+    thread_table[d_index].nmiss = 0;
+    thread_table[d_index].replenish = 0;
+    thread_table[d_index].noverrun = 0;
+
+    // Buffered output stays with the parent
+    thread_reent_init(&thread_table[d_index]);
+
     return true;
 }
 
@@ -294,6 +418,36 @@ bool thread_fork2(const thread_t* thread, thread_t** rt)
     return false;
 }
 
+/**
+ * @brief Copies an accounting snapshot of every occupied thread table entry.
+ *
+ * @param buf The array to copy into.
+ * @param len The number of entries buf can hold.
+ * @return The number of entries copied.
+ */
+uint32_t thread_stats(tstat_t* buf, uint32_t len)
+{
+    uint32_t i, n = 0;
+
+    for(i = 0; i < MAX_THREADS && n < len; i++)
+    {
+        if(thread_table[i].state == T_EMPTY)
+            continue;
+
+        buf[n].id = thread_table[i].id;
+        buf[n].state = thread_table[i].state;
+        buf[n].cycles = thread_table[i].cycles;
+        buf[n].nswitch = thread_table[i].nswitch;
+        buf[n].nsyscall = thread_table[i].nsyscall;
+        buf[n].npreempt = thread_table[i].npreempt;
+        buf[n].nmiss = thread_table[i].nmiss;
+        buf[n].noverrun = thread_table[i].noverrun;
+        n++;
+    }
+
+    return n;
+}
+
 /*
  * @brief Finds all threads waiting on the exiting thread, thread. For each
  * such thread, wake it up, and pass it the return status of the exiting thread.
@@ -320,7 +474,7 @@ void thread_notify_waiting(const thread_t* thread)
            (((tid_t)thread_table[i].regs.R1) == thread->id))
         {
             thread_table[i].regs.R0 = thread->regs.R1;
-            thread_table[i].state = T_RUNNABLE;
+            kernel_wake(&thread_table[i]);
         }
     }
 }
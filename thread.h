@@ -15,13 +15,62 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/*
+ * Both may be overridden at build time (configure.py --define); the host port
+ * needs much larger stacks than the 1 KB that suffices on the target.
+ */
+#ifndef MAX_THREADS
 #define MAX_THREADS (12)
+#endif
+#ifndef LOG2_THREAD_MEM_SIZE
 #define LOG2_THREAD_MEM_SIZE (10)
+#endif
 #define THREAD_MEM_SIZE (1<<LOG2_THREAD_MEM_SIZE)
 
+/*
+ * Give each thread its own newlib state (errno, strtok(), stdio streams), so
+ * that C library calls from different threads do not race. Not on the host,
+ * where the C library is glibc.
+ */
+#ifndef THREAD_REENT
+#ifdef PORT_HOST
+#define THREAD_REENT (0)
+#else
+#define THREAD_REENT (1)
+#endif
+#endif
+
+struct _reent;
+
+// Default time slice, in scheduler ticks
+#ifndef THREAD_QUANTUM
+#define THREAD_QUANTUM (10)
+#endif
+
+// Number of priority levels; priorities run from 0 to THREAD_PRIORITIES - 1
+#ifndef THREAD_PRIORITIES
+#define THREAD_PRIORITIES (8)
+#endif
+
+#define THREAD_PRIORITY_DEFAULT (0)
+
+// Share weight of a thread that was not given one (see KERNEL_FAIR_SHARE)
+#ifndef THREAD_WEIGHT_DEFAULT
+#define THREAD_WEIGHT_DEFAULT (100)
+#endif
+
+// Admission bound for earliest-deadline-first threads: the most their
+// budgets may add up to, in thousandths of the CPU (see sys_edf_set())
+#ifndef EDF_UTIL_BOUND
+#define EDF_UTIL_BOUND (1000)
+#endif
+
 // Type for a thread ID
 typedef uint32_t tid_t;
 
+// Type for a saved register; the width of a pointer on the CPU
+typedef uintptr_t reg_t;
+
 // Type for a thread sleep counter
 typedef uint32_t tsleep_t;
 
@@ -32,6 +81,37 @@ typedef enum
     LOCK_LOCKED = 1
 } lock_t;
 
+/*
+ * Type for an event. An event is a counter that is incremented every time it
+ * is signalled; a thread waits for it to move past a value it has already
+ * seen (see sys_event_wait()).
+ */
+typedef volatile uint32_t event_t;
+
+/*
+ * Type for the scheduling attributes given to sys_spawn_attr(). The runnable
+ * thread of highest priority runs, taking turns with others of the same
+ * priority; each turn lasts quantum ticks, unless the thread blocks or
+ * yields first. A thread of higher priority that wakes up preempts it at the
+ * next tick, and it finishes its turn afterwards.
+ */
+typedef struct
+{
+    uint32_t priority;
+    // In scheduler ticks; 0 for THREAD_QUANTUM
+    uint32_t quantum;
+    // CPU share relative to other threads of the same priority, with
+    // KERNEL_FAIR_SHARE; 0 for THREAD_WEIGHT_DEFAULT
+    uint32_t weight;
+    // At most budget ticks of CPU time every budget_period ticks; a budget
+    // of 0 for no limit
+    uint32_t budget;
+    uint32_t budget_period;
+} thread_attr_t;
+
+// Timeout for sys_event_wait() that never expires
+#define EVENT_WAIT_FOREVER (UINT32_MAX)
+
 // Type for a thread state
 typedef enum
 {
@@ -43,28 +123,28 @@ typedef enum
 // Type for a registers store
 typedef struct
 {
-	uint32_t R4;
-	uint32_t R5;
-	uint32_t R6;
-	uint32_t R7;
-	uint32_t R8;
-	uint32_t R9;
-	uint32_t R10;
-	uint32_t R11;
-
-	uint32_t SP;
-
-	uint32_t R0;
-	uint32_t R1;
-	uint32_t R2;
-	uint32_t R3;
-	uint32_t R12;
-	uint32_t LR;
-	uint32_t PC;
-	uint32_t PSR;
+	reg_t R4;
+	reg_t R5;
+	reg_t R6;
+	reg_t R7;
+	reg_t R8;
+	reg_t R9;
+	reg_t R10;
+	reg_t R11;
+
+	reg_t SP;
+
+	reg_t R0;
+	reg_t R1;
+	reg_t R2;
+	reg_t R3;
+	reg_t R12;
+	reg_t LR;
+	reg_t PC;
+	reg_t PSR;
 }__attribute__((aligned(0x4))) registers_t;
 
-#define THREAD_SAVED_REGISTERS_NUM (sizeof(registers_t)/sizeof(uint32_t))
+#define THREAD_SAVED_REGISTERS_NUM (sizeof(registers_t)/sizeof(reg_t))
 
 // Type for a thread wait status
 typedef enum
@@ -72,10 +152,16 @@ typedef enum
     // Not waiting on anything
     WAITSTATUS_NONE = 0,
     // Waiting on another thread
-    WAITSTATUS_THREAD = 1
+    WAITSTATUS_THREAD = 1,
+    // Waiting on an event
+    WAITSTATUS_EVENT = 2,
+    // Timer service thread waiting for a timer to expire
+    WAITSTATUS_TIMER = 3,
+    // In sys_usleep(), waiting for its high-resolution timer
+    WAITSTATUS_USLEEP = 4
 } twait_status_t;
 
-typedef struct
+typedef struct thread
 {
 	// Thread ID
 	tid_t id;
@@ -83,7 +169,8 @@ typedef struct
 	// Thread state
 	tstate_t state;
 
-	// Thread sleep counter
+	// Unused since wakeups moved to the 64-bit wake; kept so that regs stays
+	// at the offset kernel_asm.S expects
 	tsleep_t scnt;
 
 	// Thread registers
@@ -91,8 +178,77 @@ typedef struct
 
     // Thread wait status
 	twait_status_t waitstat;
+
+	// Tick at which a sleeping thread wakes up (see kernel_sleep())
+	uint64_t wake;
+
+	// Scheduling attributes (see thread_attr_t), and the ticks left in the
+	// current time slice
+	uint32_t priority;
+	uint32_t quantum;
+	uint32_t slice;
+
+	// Nesting depth of preempt_disable(); the thread is not preempted while
+	// it is nonzero (see critical.h)
+	volatile uint32_t preempt_count;
+
+	// Share weight, and virtual CPU time: cycles used, scaled down by the
+	// weight (see KERNEL_FAIR_SHARE)
+	uint32_t weight;
+	uint64_t pass;
+
+	// CPU budget, in ticks per budget_period ticks, or 0 for none (see
+	// kernel_budget_charge()). budget_mark is the value of cycles when the
+	// budget was last refilled, and replenish the tick of the next refill;
+	// noverrun counts the times the thread ran out and was throttled.
+	uint32_t budget;
+	uint32_t budget_period;
+	uint64_t budget_mark;
+	uint64_t replenish;
+	uint32_t noverrun;
+
+	// Earliest-deadline-first parameters, in ticks (see sys_edf_set()); a
+	// period of 0 for a best-effort thread. The current job was released at
+	// edf_release and is due at edf_due; nmiss counts jobs finished late.
+	uint32_t edf_period;
+	uint32_t edf_budget;
+	uint32_t edf_deadline;
+	uint64_t edf_release;
+	uint64_t edf_due;
+	uint32_t nmiss;
+
+	// CPU time consumed, in cycles (see kernel_account())
+	uint64_t cycles;
+
+	// Number of times the thread was switched to, entered a system call, and
+	// was switched away from by the scheduler tick while still runnable
+	uint32_t nswitch;
+	uint32_t nsyscall;
+	uint32_t npreempt;
+
+	// newlib state, installed as _impure_ptr while the thread runs (see
+	// thread_reent_init())
+	struct _reent* reent;
+
+	// Links in the scheduling policy's run queue (see sched.h); both NULL
+	// while the thread is on none
+	struct thread* rq_next;
+	struct thread* rq_prev;
 } thread_t;
 
+// Type for a per-thread accounting snapshot, as returned by sys_thread_stats()
+typedef struct
+{
+	tid_t id;
+	tstate_t state;
+	uint64_t cycles;
+	uint32_t nswitch;
+	uint32_t nsyscall;
+	uint32_t npreempt;
+	uint32_t nmiss;
+	uint32_t noverrun;
+} tstat_t;
+
 // Declare a global thread table, current thread index, and thread memory array.
 extern thread_t thread_table[];
 extern thread_t* thread_current;
@@ -106,7 +262,10 @@ bool thread_kill(thread_t* thread);
 bool thread_kill2(tid_t tid);
 bool thread_in_table(const thread_t* thread);
 thread_t* tt_entry_for_tid(tid_t id);
+uint32_t thread_stats(tstat_t* buf, uint32_t len);
 tid_t thread_spawn(const int (*entry)(void*), const void* arg);
+tid_t thread_spawn_attr(const int (*entry)(void*), const void* arg,
+                        const thread_attr_t* attr);
 uint32_t thread_pos(const thread_t* thread);
 void thread_init(void);
 void thread_notify_waiting(const thread_t* thread);
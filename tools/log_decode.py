@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Formats a tokenized log capture (see log.h) as text, using the format
+strings in the .logstr section of the ELF that produced it.
+
+Usage: log_decode.py main.elf capture.bin [--hz F_CPU]
+
+The capture is the raw byte stream read from the serial port the log drain
+thread writes to. Bytes that do not start a record are skipped, so the
+decoder resynchronizes after noise or a partial record. Each line shows the
+timestamp in seconds, the thread id, and the formatted message.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_SYNC = 0xA5
+LOG_SYNC_DROPPED = 0xA6
+LOG_MAX_ARGS = 8
+
+# One printf conversion: flags, width, precision, length, conversion
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(\.\d+)?(hh|h|ll|l|z|j|t)?([diuxXocp%])")
+
+
+def read_logstr(path):
+    """Returns (address, bytes) of the .logstr section of an ELF file."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise SystemExit("%s: not an ELF file" % path)
+    is64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        shdr = struct.Struct(endian + "IIQQQQIIQQ")
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        shdr = struct.Struct(endian + "IIIIIIIIII")
+
+    sections = [shdr.unpack_from(elf, shoff + i * shentsize)
+                for i in range(shnum)]
+    strtab = sections[shstrndx]
+    for name, _, _, addr, offset, size, _, _, _, _ in sections:
+        start = strtab[4] + name
+        if elf[start:elf.index(b"\0", start)] == b".logstr":
+            return addr, elf[offset:offset + size]
+    raise SystemExit("%s: no .logstr section; was LOG() used?" % path)
+
+
+def format_message(fmt, args):
+    """Applies a printf format string to 32-bit integer arguments."""
+    args = list(args)
+
+    def convert(m):
+        flags, width, precision, _, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if not args:
+            return "<missing>"
+        value = args.pop(0)
+        if conv in "di":
+            value -= (value & 0x80000000) << 1
+        elif conv == "p":
+            return "0x%08x" % value
+        spec = "%" + flags + width + (precision or "") + ("d" if conv == "u" else conv)
+        return spec % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(data, logstr_addr, logstr, hz, out):
+    pos = 0
+    while pos + 8 <= len(data):
+        head, = struct.unpack_from("<I", data, pos)
+        sync, nargs, tid = head & 0xFF, (head >> 8) & 0xFF, head >> 16
+
+        if sync == LOG_SYNC_DROPPED and nargs == 0:
+            count, = struct.unpack_from("<I", data, pos + 4)
+            out.write("%12s  [%d] <%d records dropped>\n" % ("", tid, count))
+            pos += 8
+            continue
+
+        if sync != LOG_SYNC or nargs > LOG_MAX_ARGS:
+            pos += 1
+            continue
+        end = pos + 12 + 4 * nargs
+        if end > len(data):
+            break
+
+        token, stamp = struct.unpack_from("<II", data, pos + 4)
+        offset = token - logstr_addr
+        if not 0 <= offset < len(logstr):
+            pos += 1
+            continue
+        fmt = logstr[offset:logstr.index(b"\0", offset)].decode("utf-8", "replace")
+        args = struct.unpack_from("<%dI" % nargs, data, pos + 12)
+
+        out.write("%12.6f  [%d] %s\n" % (stamp / hz, tid,
+                                         format_message(fmt, args).rstrip("\r\n")))
+        pos = end
+
+
+def main():
+    parser = argparse.ArgumentParser(description = __doc__.strip().split("\n")[0])
+    parser.add_argument("elf", help = "the ELF file that produced the log")
+    parser.add_argument("capture", help = "raw bytes read from the log port")
+    parser.add_argument("--hz", type = float, default = 80e6,
+                        help = "timestamp clock, i.e. F_CPU (default: 80e6)")
+    args = parser.parse_args()
+
+    addr, logstr = read_logstr(args.elf)
+    with open(args.capture, "rb") as f:
+        data = f.read()
+    decode(data, addr, logstr, args.hz, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
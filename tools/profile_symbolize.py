@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""
+Symbolizes a PC-sampling profile dump (see profile.h) against main.elf and
+prints a flat profile, hottest functions first.
+
+Usage: profile_symbolize.py capture.bin [-e main.elf] [--per-thread]
+                            [--addr2line arm-none-eabi-addr2line]
+
+The capture is the raw byte stream read from the serial port while
+profile_dump() ran; any other output around the dump is skipped. For the host
+port, pass --addr2line addr2line.
+"""
+
+import argparse
+import collections
+import struct
+import subprocess
+import sys
+
+PROFILE_MAGIC = 0x31465250
+HEADER = struct.Struct("<IIIIII")
+
+
+def parse_dump(data):
+    pos = data.rfind(struct.pack("<I", PROFILE_MAGIC))
+    if pos < 0:
+        sys.exit("no profile dump found in capture")
+    _, hz, pc_bytes, samples, dropped, count = HEADER.unpack_from(data, pos)
+    entry = struct.Struct("<" + ("I" if pc_bytes == 4 else "Q") + "II")
+    pos += HEADER.size
+    entries = []
+    for i in range(count):
+        if pos + entry.size > len(data):
+            sys.stderr.write("warning: truncated dump\n")
+            break
+        entries.append(entry.unpack_from(data, pos))
+        pos += entry.size
+    return hz, samples, dropped, entries
+
+
+def symbolize(elf, addr2line, pcs):
+    """Maps each PC to 'function (file:line)' with one addr2line run."""
+    pcs = sorted(set(pcs))
+    if not pcs:
+        return {}
+    out = subprocess.run([addr2line, "-f", "-C", "-e", elf] +
+                         ["0x%x" % pc for pc in pcs],
+                         capture_output=True, text=True, check=True).stdout
+    lines = out.splitlines()
+    names = {}
+    for i, pc in enumerate(pcs):
+        func, loc = lines[2 * i], lines[2 * i + 1]
+        names[pc] = (func, loc.split("/")[-1])
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("capture", help="binary serial capture")
+    parser.add_argument("-e", "--elf", default="main.elf")
+    parser.add_argument("--addr2line", default="arm-none-eabi-addr2line")
+    parser.add_argument("--per-thread", action="store_true",
+                        help="break the profile down by thread")
+    parser.add_argument("-n", "--top", type=int, default=30,
+                        help="number of rows to print (default: 30)")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        hz, samples, dropped, entries = parse_dump(f.read())
+
+    names = symbolize(args.elf, args.addr2line, [pc for pc, _, _ in entries])
+
+    by_func = collections.Counter()
+    lines = {}
+    for pc, tid, count in entries:
+        func, loc = names.get(pc, ("??", "??:0"))
+        key = (tid, func) if args.per_thread else func
+        by_func[key] += count
+        lines.setdefault(key, collections.Counter())[loc] += count
+
+    total = sum(by_func.values())
+    print("%d samples at %d Hz (%.1f s), %d dropped" %
+          (samples, hz, samples / float(hz), dropped))
+    print("%7s %8s  %s" % ("percent", "samples", "function (hottest line)"))
+    for key, count in by_func.most_common(args.top):
+        hottest = lines[key].most_common(1)[0][0]
+        label = ("[tid %d] %s" % key) if args.per_thread else key
+        print("%6.2f%% %8d  %s (%s)" %
+              (100.0 * count / total, count, label, hottest))
+
+
+if __name__ == "__main__":
+    main()
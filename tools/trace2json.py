@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Converts a scheduler trace dump (see trace.h) into Chrome trace event JSON,
+which can be loaded in chrome://tracing or https://ui.perfetto.dev.
+
+Usage: trace2json.py capture.bin [-o trace.json]
+
+The capture is the raw byte stream read from the serial port while
+trace_dump() ran; any other output around the dump is skipped. Several dumps
+in one capture are concatenated in order. Each thread gets its own track,
+with a "run" slice for every interval it held the CPU and instant events
+for its system calls, wakeups, and the interrupts that arrived while it ran.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x31435254
+HEADER = struct.Struct("<IIII")
+RECORD = struct.Struct("<IHBB")
+
+TRACE_RUN, TRACE_SYSCALL, TRACE_WAKEUP, TRACE_ISR, TRACE_THROTTLE = range(5)
+
+# Mirrors syscall_numbers.h
+SYSCALL_NAMES = {
+    0: "exit", 1: "yield", 2: "sleep", 3: "spawn", 4: "fork", 5: "reset",
+    6: "wait", 7: "kill", 8: "get_tid", 9: "lock", 10: "unlock",
+    11: "thread_stats", 12: "event_wait", 13: "timer_set", 14: "timer_next",
+    15: "sleep_until", 16: "time", 17: "usleep", 18: "hrtimer_set",
+    19: "heap", 20: "spawn_attr", 21: "edf_set", 22: "edf_wait",
+    23: "set_weight", 24: "set_budget",
+}
+
+
+def parse_dumps(data):
+    """Yields (cycles_per_sec, dropped, records) for every dump in data."""
+    magic = struct.pack("<I", TRACE_MAGIC)
+    pos = data.find(magic)
+    while pos >= 0 and pos + HEADER.size <= len(data):
+        _, freq, dropped, count = HEADER.unpack_from(data, pos)
+        pos += HEADER.size
+        end = pos + count * RECORD.size
+        if end > len(data):
+            sys.stderr.write("warning: truncated dump, %d of %d records\n" %
+                             ((len(data) - pos) // RECORD.size, count))
+            count = (len(data) - pos) // RECORD.size
+            end = pos + count * RECORD.size
+        records = [RECORD.unpack_from(data, pos + i * RECORD.size)
+                   for i in range(count)]
+        yield freq, dropped, records
+        pos = data.find(magic, end)
+
+
+def convert(data):
+    events = []
+    tids = set()
+    running = None      # (tid, start_us)
+    last_raw = None
+    epoch = 0
+
+    for freq, dropped, records in parse_dumps(data):
+        if dropped:
+            sys.stderr.write("warning: %d records were overwritten\n" % dropped)
+        for raw, tid, kind, arg in records:
+            # Unwrap the 32-bit cycle counter. Only a big step back is a wrap;
+            # a small one is two records that raced for their slots.
+            if last_raw is not None and last_raw - raw > 1 << 31:
+                epoch += 1 << 32
+            last_raw = raw
+            ts = (epoch + raw) * 1e6 / freq
+            tids.add(tid)
+
+            if kind == TRACE_RUN:
+                if running is not None and running[0] != tid:
+                    events.append({"name": "run", "ph": "X", "pid": 0,
+                                   "tid": running[0], "ts": running[1],
+                                   "dur": ts - running[1]})
+                    running = None
+                if running is None:
+                    running = (tid, ts)
+            elif kind == TRACE_SYSCALL:
+                events.append({"name": SYSCALL_NAMES.get(arg, "syscall %d" % arg),
+                               "cat": "syscall", "ph": "i", "s": "t",
+                               "pid": 0, "tid": tid, "ts": ts})
+            elif kind == TRACE_WAKEUP:
+                events.append({"name": "wakeup", "cat": "sched", "ph": "i",
+                               "s": "t", "pid": 0, "tid": tid, "ts": ts})
+            elif kind == TRACE_ISR:
+                events.append({"name": "irq %d" % arg, "cat": "isr", "ph": "i",
+                               "s": "t", "pid": 0, "tid": tid, "ts": ts})
+            elif kind == TRACE_THROTTLE:
+                events.append({"name": "throttle", "cat": "sched", "ph": "i",
+                               "s": "t", "pid": 0, "tid": tid, "ts": ts})
+
+    # Close the slice of whichever thread was running at the end of the dump
+    if running is not None:
+        events.append({"name": "run", "ph": "X", "pid": 0, "tid": running[0],
+                       "ts": running[1], "dur": ts - running[1]})
+
+    for tid in sorted(tids):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid,
+                       "args": {"name": "tid %d" % tid}})
+
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("capture", help="binary serial capture")
+    parser.add_argument("-o", "--output", default="-",
+                        help="output JSON file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        trace = convert(f.read())
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    json.dump(trace, out)
+    out.write("\n")
+
+
+if __name__ == "__main__":
+    main()
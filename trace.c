@@ -0,0 +1,61 @@
+/**
+ * @brief Scheduler event trace ring buffer; see trace.h.
+ */
+
+#include "trace.h"
+
+#include <stdint.h>
+
+#if KERNEL_TRACE
+
+trace_record_t trace_buf[TRACE_BUF_SIZE];
+
+// Free-running index of the next record to write
+uint32_t trace_head;
+
+volatile bool trace_paused;
+
+// trace_head at the end of the previous dump
+static uint32_t trace_dumped;
+
+/**
+ * @brief Drains the trace ring to a serial port: writes every record added
+ * since the previous dump that has not yet been overwritten, oldest first.
+ * Tracing is paused for the duration, so that the records being sent cannot
+ * be overwritten.
+ *
+ * @param module The serial port to write to.
+ */
+void trace_dump(Serial_module_e module)
+{
+    uint32_t header[4], head, count, dropped = 0, i;
+
+    trace_paused = true;
+
+    head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+    count = head - trace_dumped;
+    if(count > TRACE_BUF_SIZE)
+    {
+        dropped = count - TRACE_BUF_SIZE;
+        count = TRACE_BUF_SIZE;
+    }
+
+    header[0] = TRACE_MAGIC;
+    header[1] = F_CPU;
+    header[2] = dropped;
+    header[3] = count;
+    Serial_writebuf(module, (const uint8_t*) header, sizeof(header));
+
+    for(i = head - count; i != head; i++)
+    {
+        Serial_writebuf(module,
+                        (const uint8_t*) &trace_buf[i & (TRACE_BUF_SIZE - 1)],
+                        sizeof(trace_record_t));
+    }
+
+    trace_dumped = head;
+
+    trace_paused = false;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * trace.h
+ *
+ * Scheduler event trace. When KERNEL_TRACE is enabled, the kernel records a
+ * compact timestamped record into a ring buffer at every kernel_run(), system
+ * call entry, and sleeper wakeup; ISRs can add their own records with
+ * trace_isr(). The ring overwrites its oldest records and never blocks.
+ *
+ * trace_dump() writes the ring to a serial port in the binary format below;
+ * tools/trace2json.py turns a capture into Chrome trace / Perfetto JSON.
+ *
+ * Dump format (all fields little-endian):
+ *      uint32_t magic          TRACE_MAGIC
+ *      uint32_t cycles_per_sec F_CPU
+ *      uint32_t dropped        records overwritten before this dump
+ *      uint32_t count          number of records that follow, oldest first
+ *      trace_record_t records[count]
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "kernel.h"
+#include "port.h"
+#include "thread.h"
+#include "drivers/driver_serial.h"
+
+#include <stdint.h>
+
+#ifndef TRACE_BUF_SIZE
+#define TRACE_BUF_SIZE (256) // records; must be a power of two
+#endif
+
+#define TRACE_MAGIC (0x31435254) // "TRC1"
+
+// Type for a trace event type
+typedef enum
+{
+    // tid was switched to (or resumed by) kernel_run()
+    TRACE_RUN = 0,
+    // tid entered the kernel with system call number arg
+    TRACE_SYSCALL = 1,
+    // tid was woken from sleep by the scheduler tick
+    TRACE_WAKEUP = 2,
+    // interrupt arg fired while tid was current
+    TRACE_ISR = 3,
+    // tid used up its CPU budget and was throttled
+    TRACE_THROTTLE = 4
+} trace_type_t;
+
+// Type for a trace record
+typedef struct
+{
+    uint32_t time;
+    uint16_t tid;
+    uint8_t type;
+    uint8_t arg;
+} trace_record_t;
+
+#if KERNEL_TRACE
+
+extern trace_record_t trace_buf[TRACE_BUF_SIZE];
+extern uint32_t trace_head;
+extern volatile bool trace_paused;
+
+/**
+ * @brief Appends a record to the trace ring. Callable from the kernel, ISRs of
+ * any priority, and threads.
+ */
+static inline void trace_event(trace_type_t type, tid_t tid, uint8_t arg)
+{
+    trace_record_t* rec;
+    uint32_t head, time;
+
+    if(trace_paused)
+        return;
+
+    // Read the time between loading trace_head and claiming the slot, and
+    // retry if an ISR claimed one in between, so records are in time order
+    head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+    do
+        time = port_cycles();
+    while(!__atomic_compare_exchange_n(&trace_head, &head, head + 1, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    rec = &trace_buf[head & (TRACE_BUF_SIZE - 1)];
+    rec->time = time;
+    rec->tid = (uint16_t) tid;
+    rec->type = (uint8_t) type;
+    rec->arg = arg;
+}
+
+/**
+ * @brief Records that interrupt irq fired. Call at the top of an ISR.
+ */
+static inline void trace_isr(uint8_t irq)
+{
+    trace_event(TRACE_ISR, thread_current ? thread_current->id : 0, irq);
+}
+
+void trace_dump(Serial_module_e module);
+
+#else
+
+#define trace_event(type, tid, arg) do { } while(0)
+#define trace_isr(irq) do { } while(0)
+#define trace_dump(module) do { } while(0)
+
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,139 @@
+/**
+ * @brief Deferred interrupt work queue and the thread that services it; see
+ * work.h.
+ */
+
+#include "work.h"
+#include "kernel.h"
+#include "syscalls.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WORK_QUEUE_MASK (WORK_QUEUE_SIZE - 1)
+
+#if (WORK_QUEUE_SIZE & WORK_QUEUE_MASK) != 0
+#error "WORK_QUEUE_SIZE must be a power of two"
+#endif
+
+/*
+ * A queue slot. seq tells producers and the consumer whose turn it is: a
+ * slot at position pos is free for the producer that claims pos when
+ * seq == pos, and holds work for the consumer when seq == pos + 1.
+ */
+typedef struct
+{
+    volatile uint32_t seq;
+    work_fn_t fn;
+    void* ctx;
+} work_item_t;
+
+static work_item_t work_queue[WORK_QUEUE_SIZE];
+
+// Next position to claim (producers) and to run (the work thread)
+static uint32_t work_enqueue_pos;
+static uint32_t work_dequeue_pos;
+
+// Signalled on every successful work_defer()
+static event_t work_event;
+
+volatile uint32_t work_dropped;
+
+/**
+ * @brief Queues fn(ctx) to be run by the work thread. Safe to call from any
+ * ISR that runs at or below the kernel's interrupt priority, since it signals
+ * the kernel event the work thread sleeps on.
+ *
+ * @return false if the queue was full and the work was dropped.
+ */
+bool work_defer(work_fn_t fn, void* ctx)
+{
+    uint32_t pos = __atomic_load_n(&work_enqueue_pos, __ATOMIC_RELAXED);
+    work_item_t* item;
+    int32_t diff;
+
+    while(1)
+    {
+        item = &work_queue[pos & WORK_QUEUE_MASK];
+        diff = (int32_t)(__atomic_load_n(&item->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if(diff == 0)
+        {
+            // The slot is free; claim it, or retry with the position the
+            // producer that beat us to it left behind
+            if(__atomic_compare_exchange_n(&work_enqueue_pos, &pos, pos + 1,
+                                           true, __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+                break;
+        }
+        else if(diff < 0)
+        {
+            // The work thread has not emptied this slot yet: full
+            work_dropped++;
+            return false;
+        }
+        else
+        {
+            pos = __atomic_load_n(&work_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    item->fn = fn;
+    item->ctx = ctx;
+    __atomic_store_n(&item->seq, pos + 1, __ATOMIC_RELEASE);
+
+    kernel_event_signal(&work_event);
+    return true;
+}
+
+static int work_main(void* arg)
+{
+    work_item_t* item;
+    work_fn_t fn;
+    void* ctx;
+    uint32_t seen;
+
+    (void) arg;
+
+    while(1)
+    {
+        seen = work_event;
+        item = &work_queue[work_dequeue_pos & WORK_QUEUE_MASK];
+
+        if(__atomic_load_n(&item->seq, __ATOMIC_ACQUIRE) !=
+           work_dequeue_pos + 1)
+        {
+            // Empty (or a producer is still filling the slot, in which case
+            // it signals once it is done)
+            sys_event_wait(&work_event, seen, EVENT_WAIT_FOREVER);
+            continue;
+        }
+
+        fn = item->fn;
+        ctx = item->ctx;
+        __atomic_store_n(&item->seq, work_dequeue_pos + WORK_QUEUE_SIZE,
+                         __ATOMIC_RELEASE);
+        work_dequeue_pos++;
+
+        fn(ctx);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Initializes the queue and spawns the work thread. Call once, after
+ * kernel_init() and before enabling interrupts that defer work.
+ *
+ * @return The work thread's tid, or 0 if no thread slot was free.
+ */
+tid_t work_start(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < WORK_QUEUE_SIZE; i++)
+        work_queue[i].seq = i;
+    work_enqueue_pos = work_dequeue_pos = 0;
+
+    return sys_spawn(work_main, NULL);
+}
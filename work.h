@@ -0,0 +1,42 @@
+/*
+ * work.h
+ *
+ * Deferred interrupt work ("bottom halves"). An ISR that has more to do
+ * than acknowledge its peripheral calls work_defer() with a callback and a
+ * context pointer and returns; the work thread started by work_start() runs
+ * the callbacks in order, in thread context, where they may block, take
+ * locks and make system calls. Interrupts stay masked only for as long as
+ * the ISR itself runs.
+ *
+ * The queue is a bounded multi-producer ring with a sequence number per
+ * slot: producers claim a slot with a compare-and-swap (LDREX/STREX on
+ * Cortex-M), so ISRs at different priorities can defer work concurrently
+ * without masking interrupts. When the queue is full, work_defer() fails
+ * and the loss is counted in work_dropped.
+ *
+ * work_defer() is for ISRs. A thread that wants work done can call the
+ * function itself.
+ */
+
+#ifndef WORK_H_
+#define WORK_H_
+
+#include "thread.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef WORK_QUEUE_SIZE
+#define WORK_QUEUE_SIZE (32) // entries; must be a power of two
+#endif
+
+// Type for a deferred work callback
+typedef void (*work_fn_t)(void* ctx);
+
+// Number of work_defer() calls that failed because the queue was full
+extern volatile uint32_t work_dropped;
+
+bool work_defer(work_fn_t fn, void* ctx);
+tid_t work_start(void);
+
+#endif /* WORK_H_ */